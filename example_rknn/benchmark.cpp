@@ -0,0 +1,965 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+#include "const.hpp"
+#include "utils.hpp"
+#include "preprocess.h"
+#include "tile_batch.hpp"
+#include "class_map.hpp"
+#include "postprocess.h"
+#include "tile_filter.hpp"
+#include "result_cache.hpp"
+#include "tiling.hpp"
+#include "softmax.h"
+#include "topk.h"
+#include "yolo_scan.h"
+#include "nms.h"
+#include "trace.h"
+#include "ingest.hpp"
+#include "tiled_source.hpp"
+#include "thread_pool.h"
+#include <set>
+
+// 统计全局 operator new 次数, 用于确认热路径稳态下不分配
+static std::atomic<int64_t> g_new_calls(0);
+
+void* operator new(size_t size) {
+    g_new_calls.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// --- 模拟 1080p 整图, 切分成 ROWS x COLS 个 ROI ---
+const int FRAME_W = 1920;
+const int FRAME_H = 1080;
+const int MODEL_W = 32;
+const int MODEL_H = 32;
+const int REPEAT = 20;
+
+static cv::Mat MakeFrame(int width, int height) {
+    cv::Mat frame(height, width, CV_8UC3);
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = frame.ptr<uint8_t>(y);
+        for (int x = 0; x < width * 3; ++x) {
+            row[x] = (uint8_t)((x * 7 + y * 13) & 0xff);
+        }
+    }
+    return frame;
+}
+
+template <typename Func>
+static double TimeMs(Func&& func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// --- cvtColor + resize 两步 vs 单趟融合预处理 ---
+void RunPreprocess() {
+    cv::Mat frame = MakeFrame(FRAME_W, FRAME_H);
+    std::vector<resnet_input> inputs = split_image(frame);
+    std::vector<uint8_t> buf(MODEL_W * MODEL_H * 3);
+
+    double cv_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            for (auto& input : inputs) {
+                cv::Mat img, resized;
+                cv::cvtColor(input.img, img, cv::COLOR_BGR2RGB);
+                cv::resize(img, resized, cv::Size(MODEL_W, MODEL_H));
+            }
+        }
+    });
+
+    FusedPreprocessor preproc(MODEL_W, MODEL_H);
+    double fused_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            for (auto& input : inputs) {
+                preproc.run(input.img, buf.data());
+            }
+        }
+    });
+
+    // 校验 SIMD 路径与标量参考逐字节一致
+    std::vector<uint8_t> ref(buf.size());
+    int mismatched = 0;
+    for (auto& input : inputs) {
+        preproc.run(input.img, buf.data());
+        fused_preprocess_reference(input.img, ref.data(), MODEL_W, MODEL_H);
+        mismatched += buf != ref;
+    }
+
+    size_t tiles = inputs.size() * REPEAT;
+    std::cout << "[Preprocess] Tiles: " << tiles
+              << " | OpenCV: " << cv_ms << " ms"
+              << " | Fused: " << fused_ms << " ms"
+              << " | Speedup: " << cv_ms / fused_ms << "x"
+              << " | Mismatch: " << mismatched << std::endl;
+}
+
+// --- 逐 tile clone 拼批 vs 按源图行扫描的批打包 ---
+void RunBatchPack(int batch_size) {
+    cv::Mat frame = MakeFrame(FRAME_W, FRAME_H);
+    std::vector<resnet_input> inputs = split_image(frame);
+    int tile_w = inputs[0].img.cols;
+    int tile_h = inputs[0].img.rows;
+    size_t tile_bytes = (size_t)tile_w * tile_h * 3;
+
+    double clone_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            for (size_t first = 0; first < inputs.size(); first += batch_size) {
+                std::vector<uint8_t> batch(batch_size * tile_bytes);
+                for (int i = 0; i < batch_size && first + i < inputs.size(); ++i) {
+                    cv::Mat tile = inputs[first + i].img.clone();
+                    memcpy(batch.data() + i * tile_bytes, tile.data, tile_bytes);
+                }
+            }
+        }
+    });
+
+    TileBatchPool pool;
+    double pack_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            for (size_t first = 0; first < inputs.size(); first += batch_size) {
+                auto batch = pool.acquire();
+                pack_tile_batch(inputs, first, batch_size, tile_w, tile_h, *batch);
+            }
+        }
+    });
+
+    // PredictBatch 从打包缓冲做前处理, 结果必须与直接读 ROI 一致
+    FusedPreprocessor preproc(MODEL_W, MODEL_H);
+    std::vector<uint8_t> from_roi(MODEL_W * MODEL_H * 3), from_pack(MODEL_W * MODEL_H * 3);
+    int mismatched = 0;
+    auto batch = pool.acquire();
+    for (size_t first = 0; first < inputs.size(); first += batch_size) {
+        int n = pack_tile_batch(inputs, first, batch_size, tile_w, tile_h, *batch);
+        for (int i = 0; i < n; ++i) {
+            preproc.run(inputs[first + i].img, from_roi.data());
+            preproc.run(cv::Mat(tile_h, tile_w, CV_8UC3, batch->tile(i)), from_pack.data());
+            mismatched += from_roi != from_pack;
+        }
+    }
+
+    std::cout << "[BatchPack ] Batch: " << batch_size
+              << " | Clone: " << clone_ms << " ms"
+              << " | Pack: " << pack_ms << " ms"
+              << " | Speedup: " << clone_ms / pack_ms << "x"
+              << " | Preprocess mismatch: " << mismatched << std::endl;
+}
+
+static std::vector<resnet_results> MakeResults(size_t count, int num_classes) {
+    std::vector<resnet_results> results(count);
+    for (size_t i = 0; i < count; ++i) {
+        results[i].id = (int)i;
+        results[i].result[0].cls = (int)((i * 7 + i / COLS) % num_classes);
+        results[i].result[0].score = 0.5f;
+    }
+    return results;
+}
+
+// --- 五张全尺寸类别图 vs 类别网格 ---
+void RunClassMap() {
+    cv::Mat frame = MakeFrame(FRAME_W, FRAME_H);
+    std::vector<resnet_input> inputs = split_image(frame);
+    std::vector<resnet_results> results = MakeResults(inputs.size(), 5);
+
+    double synth_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            auto outputs = synthesize_image(inputs, results);
+        }
+    });
+    double map_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            ClassMap class_map = ClassMap::from_results(results);
+        }
+    });
+
+    size_t canvas_bytes = (size_t)ROWS * inputs[0].img.rows * COLS * inputs[0].img.cols * 3 * 5;
+    size_t map_bytes = (size_t)ROWS * COLS * (sizeof(int16_t) + sizeof(float));
+    std::cout << "[ClassMap  ] synthesize_image: " << synth_ms / REPEAT << " ms, " << canvas_bytes / 1024 << " KB"
+              << " | ClassMap: " << map_ms / REPEAT << " ms, " << map_bytes / 1024 << " KB" << std::endl;
+}
+
+static std::vector<resnet_input> SplitGrid(cv::Mat& frame, int rows, int cols) {
+    std::vector<resnet_input> inputs;
+    int block_w = frame.cols / cols;
+    int block_h = frame.rows / rows;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            inputs.push_back(resnet_input(frame(cv::Rect(j * block_w, i * block_h, block_w, block_h)), i * cols + j));
+        }
+    }
+    return inputs;
+}
+
+// --- 串行逐类渲染 vs 并行合成器, 五个类别全部出图 ---
+void RunCompose(int rows, int cols, int width, int height) {
+    cv::Mat frame = MakeFrame(width, height);
+    std::vector<resnet_input> inputs = SplitGrid(frame, rows, cols);
+    std::vector<resnet_results> results = MakeResults(inputs.size(), 5);
+    ClassMap class_map = ClassMap::from_results(results, rows, cols);
+    std::vector<int> classes = {0, 1, 2, 3, 4};
+
+    double synth_ms = -1;
+    if (rows == ROWS && cols == COLS) {
+        synth_ms = TimeMs([&]() {
+            for (int r = 0; r < REPEAT; ++r) {
+                auto outputs = synthesize_image(inputs, results);
+            }
+        }) / REPEAT;
+    }
+    double serial_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            for (int cls : classes) {
+                cv::Mat output = class_map.render_class(inputs, cls);
+            }
+        }
+    }) / REPEAT;
+
+    ClassCompositor compositor;
+    std::vector<cv::Mat> outputs;
+    double parallel_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            compositor.render(class_map, inputs, classes, outputs);
+        }
+    }) / REPEAT;
+
+    int mismatched = 0;
+    for (size_t k = 0; k < classes.size(); ++k) {
+        cv::Mat expected = class_map.render_class(inputs, classes[k]);
+        for (int y = 0; y < expected.rows; ++y) {
+            mismatched += memcmp(expected.ptr<uint8_t>(y), outputs[k].ptr<uint8_t>(y), expected.cols * 3) != 0;
+        }
+    }
+
+    // 非等分布局: 图像尺寸不整除时 Shift 重叠 / Pad 越界, 与 render_class 逐行比对
+    cv::Mat cropped = frame(cv::Rect(0, 0, width - 7, height - 5));
+    for (BorderPolicy border : {BorderPolicy::Shift, BorderPolicy::Pad}) {
+        TileLayout layout = TilingSpec::grid(rows, cols, border).resolve(cropped.cols, cropped.rows);
+        std::vector<resnet_input> tiles = split_image(cropped, layout);
+        compositor.render(class_map, tiles, layout, classes, outputs);
+        for (size_t k = 0; k < classes.size(); ++k) {
+            cv::Mat expected = class_map.render_class(tiles, classes[k], layout);
+            for (int y = 0; y < expected.rows; ++y) {
+                mismatched += memcmp(expected.ptr<uint8_t>(y), outputs[k].ptr<uint8_t>(y), expected.cols * 3) != 0;
+            }
+        }
+    }
+
+    std::cout << "[Compose   ] Grid: " << rows << "x" << cols << " (" << width << "x" << height << ")"
+              << " | synthesize_image: " << synth_ms << " ms"
+              << " | Serial: " << serial_ms << " ms"
+              << " | Parallel: " << parallel_ms << " ms"
+              << " | Mismatch rows (grid/shift/pad): " << mismatched << std::endl;
+}
+
+// --- 纯色 tile 过滤: SIMD 单趟矩统计 vs 双精度标量逐像素, 半数 tile 为纯色 ---
+void RunTileFilter() {
+    cv::Mat frame = MakeFrame(FRAME_W, FRAME_H);
+    std::vector<resnet_input> inputs = split_image(frame);
+    // 一半 tile 纯色: 其中一半白色, 一半暗色 (补边 / 阴影)
+    for (size_t i = 0; i < inputs.size(); i += 2) {
+        inputs[i].img.setTo(i % 4 == 0 ? cv::Scalar(245, 240, 235) : cv::Scalar(20, 30, 25));
+    }
+
+    std::vector<TileMoments> simd(inputs.size()), ref(inputs.size());
+    double simd_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                compute_tile_moments(inputs[i].img, simd[i]);
+            }
+        }
+    });
+    double scalar_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                const cv::Mat& img = inputs[i].img;
+                double sum[3] = {0, 0, 0}, sq[3] = {0, 0, 0};
+                for (int y = 0; y < img.rows; ++y) {
+                    const uint8_t* p = img.ptr<uint8_t>(y);
+                    for (int x = 0; x < img.cols * 3; ++x) {
+                        sum[x % 3] += p[x];
+                        sq[x % 3] += p[x] * p[x];
+                    }
+                }
+                double n = (double)img.rows * img.cols;
+                for (int c = 0; c < 3; ++c) {
+                    ref[i].mean[c] = (float)(sum[c] / n);
+                    ref[i].var[c] = (float)(sq[c] / n - (sum[c] / n) * (sum[c] / n));
+                }
+            }
+        }
+    });
+
+    int mismatched = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            mismatched += fabsf(simd[i].mean[c] - ref[i].mean[c]) > 1e-3f || fabsf(simd[i].var[c] - ref[i].var[c]) > 1e-2f;
+        }
+    }
+
+    TileFilterParams params;
+    params.enabled = true;
+    TileFilter filter(params);
+    int white = 0;
+    for (auto& input : inputs) {
+        resnet_results res;
+        if (filter.classify(input, res) && res.result[0].cls == params.blank_class) {
+            white++;
+        }
+    }
+    TileFilterStats stats = filter.stats();
+
+    std::cout << "[TileFilter] Tiles: " << inputs.size() * REPEAT
+              << " | Scalar: " << scalar_ms << " ms"
+              << " | SIMD: " << simd_ms << " ms"
+              << " | Speedup: " << scalar_ms / simd_ms << "x"
+              << " | Skipped: " << stats.skipped << "/" << stats.checked << " (white " << white << ")"
+              << " | Mismatch: " << mismatched << std::endl;
+}
+
+// --- 内容哈希缓存: 首帧全部未命中写入, 同一帧再查一遍应全部命中 ---
+void RunResultCache() {
+    cv::Mat frame = MakeFrame(FRAME_W, FRAME_H);
+    std::vector<resnet_input> inputs = split_image(frame);
+    std::vector<resnet_results> results = MakeResults(inputs.size(), 5);
+    // 合成帧是周期图案, 在每个 tile 首像素写入 id 使内容互不相同
+    for (auto& input : inputs) {
+        memcpy(input.img.ptr<uint8_t>(0), &input.id, sizeof(input.id));
+    }
+    ResultCache cache;
+
+    std::vector<uint64_t> keys(inputs.size());
+    double hash_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                keys[i] = cache.key_of(inputs[i].img);
+            }
+        }
+    }) / REPEAT;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        resnet_results res;
+        if (!cache.lookup(keys[i], res)) {
+            cache.insert(keys[i], results[i]);
+        }
+    }
+    int wrong = 0;
+    double lookup_ms = TimeMs([&]() {
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            resnet_results res;
+            wrong += !cache.lookup(cache.key_of(inputs[i].img), res) || res.result[0].cls != results[i].result[0].cls;
+        }
+    });
+
+    ResultCacheStats stats = cache.stats();
+    std::cout << "[ResultCache] Hash frame: " << hash_ms << " ms"
+              << " | Hash+lookup frame: " << lookup_ms << " ms"
+              << " | Hits: " << stats.hits << " Misses: " << stats.misses
+              << " | Wrong: " << wrong << std::endl;
+}
+
+// --- 四趟 libm softmax vs 单趟向量化 softmax, 报告最大相对误差 ---
+void RunSoftmax(int rows, int cols) {
+    std::vector<float> logits((size_t)rows * cols);
+    uint32_t seed = 12345;
+    for (auto& v : logits) {
+        seed = seed * 1664525u + 1013904223u;
+        v = (float)(seed >> 8) / (1 << 24) * 40.f - 20.f;
+    }
+    std::vector<float> ref(logits), out(logits.size()), log_out(logits.size());
+    int repeat = std::max(1, 2000000 / (rows * cols)) * REPEAT;
+
+    double ref_ms = TimeMs([&]() {
+        for (int r = 0; r < repeat; ++r) {
+            memcpy(ref.data(), logits.data(), logits.size() * sizeof(float));
+            for (int i = 0; i < rows; ++i) {
+                softmax_reference(ref.data() + (size_t)i * cols, cols);
+            }
+        }
+    });
+    double simd_ms = TimeMs([&]() {
+        for (int r = 0; r < repeat; ++r) {
+            softmax_rows(logits.data(), out.data(), rows, cols);
+        }
+    });
+    log_softmax_rows(logits.data(), log_out.data(), rows, cols);
+
+    double max_rel = 0, max_log = 0;
+    for (size_t i = 0; i < logits.size(); ++i) {
+        if (ref[i] > 1e-30f) {
+            max_rel = std::max(max_rel, (double)fabsf(out[i] - ref[i]) / ref[i]);
+            max_log = std::max(max_log, (double)fabsf(log_out[i] - logf(ref[i])));
+        }
+    }
+
+    std::cout << "[Softmax   ] " << rows << "x" << cols
+              << " | libm: " << ref_ms << " ms"
+              << " | SIMD: " << simd_ms << " ms"
+              << " | Speedup: " << ref_ms / simd_ms << "x"
+              << " | Max rel err: " << max_rel
+              << " | Max log err: " << max_log << std::endl;
+}
+
+// --- malloc + 全量快速排序 vs 部分选择. k = CLASS_NUM 走原接口, 更大的 k 与 std::sort 全排序比较 ---
+void RunTopK(int rows, int cols, int k) {
+    std::vector<float> scores((size_t)rows * cols);
+    uint32_t seed = 54321;
+    for (auto& v : scores) {
+        seed = seed * 1664525u + 1013904223u;
+        v = (float)(seed >> 8) / (1 << 24);
+    }
+    int repeat = std::max(1, 200000 / (rows * cols)) * REPEAT;
+    std::vector<element_t> out((size_t)rows * k), scratch(topk_scratch_size(cols, k)), full(cols);
+
+    int mismatched = 0;
+    double ref_ms = 0, fast_ms = 0;
+    if (k == CLASS_NUM) {
+        std::vector<resnet_results> ref(rows), fast(rows);
+        ref_ms = TimeMs([&]() {
+            for (int r = 0; r < repeat; ++r) {
+                for (int i = 0; i < rows; ++i) {
+                    get_topk_reference(scores.data() + (size_t)i * cols, cols, ref[i]);
+                }
+            }
+        });
+        fast_ms = TimeMs([&]() {
+            for (int r = 0; r < repeat; ++r) {
+                for (int i = 0; i < rows; ++i) {
+                    get_topk_with_indices(scores.data() + (size_t)i * cols, cols, fast[i]);
+                }
+            }
+        });
+        for (int i = 0; i < rows; ++i) {
+            mismatched += ref[i].result[0].cls != fast[i].result[0].cls;
+        }
+    } else {
+        ref_ms = TimeMs([&]() {
+            for (int r = 0; r < repeat; ++r) {
+                for (int i = 0; i < rows; ++i) {
+                    for (int j = 0; j < cols; ++j) {
+                        full[j].value = scores[(size_t)i * cols + j];
+                        full[j].index = j;
+                    }
+                    std::sort(full.begin(), full.end(), [](const element_t& a, const element_t& b) {
+                        return a.value > b.value || (a.value == b.value && a.index < b.index);
+                    });
+                }
+            }
+        });
+        fast_ms = TimeMs([&]() {
+            for (int r = 0; r < repeat; ++r) {
+                topk_rows(scores.data(), rows, cols, k, out.data(), scratch.data());
+            }
+        });
+        // full 中留着最后一行的全排序结果
+        for (int j = 0; j < k; ++j) {
+            mismatched += full[j].index != out[(size_t)(rows - 1) * k + j].index;
+        }
+    }
+
+    std::cout << "[TopK      ] " << rows << "x" << cols << " k=" << k
+              << " | Full sort: " << ref_ms << " ms"
+              << " | Partial: " << fast_ms << " ms"
+              << " | Speedup: " << ref_ms / fast_ms << "x"
+              << " | Mismatch: " << mismatched << std::endl;
+}
+
+// --- YOLO 输出头候选扫描: 原 process() 的逐字节比较 + 跨步类别循环 vs 向量扫描 + 按块通道最大值 ---
+void RunYoloScan(int grid, float density) {
+    const int anchors = 3;
+    int grid_len = grid * grid;
+    std::vector<int8_t> head((size_t)anchors * PROP_BOX_SIZE * grid_len);
+    uint32_t seed = 777;
+    for (auto& v : head) {
+        seed = seed * 1664525u + 1013904223u;
+        v = (int8_t)((seed >> 24) % 100 - 110);
+    }
+    const int8_t thres = -60;
+    int hot = 0;
+    for (int a = 0; a < anchors; ++a) {
+        int8_t* conf = head.data() + ((size_t)PROP_BOX_SIZE * a + 4) * grid_len;
+        for (int i = 0; i < grid_len; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            // 大部分网格的置信度低于阈值, 只有 density 比例的网格成为候选
+            bool is_hot = (seed >> 8) % 10000 < density * 10000;
+            conf[i] = is_hot ? 20 : -100;
+            hot += is_hot;
+        }
+    }
+
+    std::vector<int32_t> ref_cells, cells(grid_len);
+    std::vector<int> ref_ids;
+    std::vector<int8_t> max_val(grid_len);
+    std::vector<uint8_t> max_id(grid_len);
+    std::vector<int> fast_ids;
+    int repeat = REPEAT * 20;
+
+    double ref_ms = TimeMs([&]() {
+        for (int r = 0; r < repeat; ++r) {
+            ref_cells.clear();
+            ref_ids.clear();
+            for (int a = 0; a < anchors; ++a) {
+                const int8_t* in = head.data() + (size_t)PROP_BOX_SIZE * a * grid_len;
+                for (int i = 0; i < grid_len; ++i) {
+                    if (in[4 * grid_len + i] < thres) continue;
+                    int8_t best = in[5 * grid_len + i];
+                    int best_id = 0;
+                    for (int k = 1; k < OBJ_CLASS_NUM; ++k) {
+                        int8_t prob = in[(5 + k) * grid_len + i];
+                        if (prob > best) {
+                            best = prob;
+                            best_id = k;
+                        }
+                    }
+                    ref_cells.push_back(a * grid_len + i);
+                    ref_ids.push_back(best_id);
+                }
+            }
+        }
+    });
+    double fast_ms = TimeMs([&]() {
+        for (int r = 0; r < repeat; ++r) {
+            fast_ids.clear();
+            for (int a = 0; a < anchors; ++a) {
+                const int8_t* in = head.data() + (size_t)PROP_BOX_SIZE * a * grid_len;
+                int count = scan_threshold_i8(in + 4 * grid_len, grid_len, thres, cells.data());
+                argmax_planes_i8(in + 5 * grid_len, grid_len, OBJ_CLASS_NUM, cells.data(), count,
+                                 max_val.data(), max_id.data());
+                for (int c = 0; c < count; ++c) {
+                    fast_ids.push_back(max_id[c]);
+                }
+            }
+        }
+    });
+
+    int mismatched = (int)ref_ids.size() != (int)fast_ids.size();
+    for (size_t i = 0; !mismatched && i < ref_ids.size(); ++i) {
+        mismatched += ref_ids[i] != fast_ids[i];
+    }
+    std::cout << "[YoloScan  ] " << grid << "x" << grid << "x" << anchors << " candidates " << hot
+              << " | Scalar: " << ref_ms / repeat << " ms"
+              << " | SIMD: " << fast_ms / repeat << " ms"
+              << " | Speedup: " << ref_ms / fast_ms << "x"
+              << " | Mismatch: " << mismatched << std::endl;
+}
+
+// --- 检测后处理: PostProcessContext 预热后稳态调用不分配; 多个线程各持一个上下文并发调用, 结果与单线程一致 ---
+static bool SameGroup(const detect_result_group_t& a, const detect_result_group_t& b) {
+    if (a.count != b.count) return false;
+    for (int i = 0; i < a.count; ++i) {
+        const detect_result_t& x = a.results[i];
+        const detect_result_t& y = b.results[i];
+        if (x.box.left != y.box.left || x.box.top != y.box.top || x.box.right != y.box.right ||
+            x.box.bottom != y.box.bottom || x.prop != y.prop || strcmp(x.name, y.name) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RunPostProcess(int model_size, float density, int threads, int calls) {
+    const int strides[3] = {8, 16, 32};
+    std::vector<int8_t> heads[3];
+    uint32_t seed = 4242;
+    for (int s = 0; s < 3; ++s) {
+        int grid_len = (model_size / strides[s]) * (model_size / strides[s]);
+        heads[s].resize((size_t)3 * PROP_BOX_SIZE * grid_len);
+        for (auto& v : heads[s]) {
+            seed = seed * 1664525u + 1013904223u;
+            v = (int8_t)(seed >> 24);
+        }
+        for (int a = 0; a < 3; ++a) {
+            int8_t* conf = heads[s].data() + ((size_t)PROP_BOX_SIZE * a + 4) * grid_len;
+            for (int i = 0; i < grid_len; ++i) {
+                seed = seed * 1664525u + 1013904223u;
+                conf[i] = (seed >> 8) % 10000 < density * 10000 ? 100 : -120;
+            }
+        }
+    }
+    auto labels = std::make_shared<LabelTable>();
+    for (int k = 0; k < OBJ_CLASS_NUM; ++k) {
+        labels->names.push_back("class_" + std::to_string(k));
+    }
+    // 与 RKNN 的 int8 输出一致: zp = -128, scale = 1 / 255
+    const std::vector<int32_t> zps(3, -128);
+    const std::vector<float> scales(3, 1.f / 255);
+    BOX_RECT pads = {0, 0, 0, 0};
+
+    PostProcessContext ctx(labels);
+    ctx.set_nms_params(NmsParams());
+    detect_result_group_t ref;
+    ctx.run(heads[0].data(), heads[1].data(), heads[2].data(), model_size, model_size, BOX_THRESH, pads, 1.f, 1.f,
+            zps, scales, &ref);
+
+    detect_result_group_t group;
+    int64_t new_before = g_new_calls.load();
+    double single_ms = TimeMs([&]() {
+        for (int r = 0; r < calls; ++r) {
+            ctx.run(heads[0].data(), heads[1].data(), heads[2].data(), model_size, model_size, BOX_THRESH, pads, 1.f,
+                    1.f, zps, scales, &group);
+        }
+    });
+    int64_t steady_news = g_new_calls.load() - new_before;
+
+    std::atomic<int> mismatched(0);
+    double multi_ms = TimeMs([&]() {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&]() {
+                PostProcessContext local(labels);
+                local.set_nms_params(NmsParams());
+                detect_result_group_t out;
+                for (int r = 0; r < calls; ++r) {
+                    local.run(heads[0].data(), heads[1].data(), heads[2].data(), model_size, model_size, BOX_THRESH,
+                              pads, 1.f, 1.f, zps, scales, &out);
+                    mismatched += !SameGroup(out, ref);
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+    });
+
+    std::cout << "[PostProc  ] " << model_size << "x" << model_size << " boxes " << ref.count
+              << " | Single: " << single_ms / calls << " ms"
+              << " | Steady new: " << steady_news << " / " << calls << " calls"
+              << " | " << threads << " threads x " << calls << ": " << multi_ms << " ms"
+              << " | Mismatch: " << mismatched.load() << std::endl;
+}
+
+// --- NMS: 原 post_process 的全量排序 + std::set + 每类全量扫描 (classIds 按值传递) vs 分桶 NmsEngine ---
+static float RefOverlap(const float* a, const float* b) {
+    float w = std::max(0.f, std::min(a[0] + a[2], b[0] + b[2]) - std::max(a[0], b[0]) + 1.f);
+    float h = std::max(0.f, std::min(a[1] + a[3], b[1] + b[3]) - std::max(a[1], b[1]) + 1.f);
+    float i = w * h;
+    float u = (a[2] + 1.f) * (a[3] + 1.f) + (b[2] + 1.f) * (b[3] + 1.f) - i;
+    return u <= 0.f ? 0.f : i / u;
+}
+
+static void RefNmsClass(int count, std::vector<float>& boxes, std::vector<int> classIds, std::vector<int>& order,
+                        int filterId, float threshold) {
+    for (int i = 0; i < count; ++i) {
+        if (order[i] == -1 || classIds[order[i]] != filterId) continue;
+        for (int j = i + 1; j < count; ++j) {
+            int m = order[j];
+            if (m == -1 || classIds[m] != filterId) continue;
+            if (RefOverlap(&boxes[order[i] * 4], &boxes[m * 4]) > threshold) order[j] = -1;
+        }
+    }
+}
+
+void RunNms(int count, int classes) {
+    std::vector<float> boxes(count * 4), scores(count);
+    std::vector<int> class_ids(count);
+    uint32_t seed = 4242;
+    auto next = [&seed]() { return seed = seed * 1664525u + 1013904223u, seed >> 8; };
+    // 拥挤场景: 框集中在少量热点附近, 大量相互重叠
+    for (int i = 0; i < count; ++i) {
+        int spot = next() % 40;
+        boxes[i * 4 + 0] = (spot % 8) * 80 + next() % 24;
+        boxes[i * 4 + 1] = (spot / 8) * 120 + next() % 24;
+        boxes[i * 4 + 2] = 30 + next() % 30;
+        boxes[i * 4 + 3] = 60 + next() % 30;
+        scores[i] = (next() % 10000) / 10000.f;
+        class_ids[i] = next() % classes;
+    }
+
+    std::vector<int> ref;
+    double ref_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            std::vector<int> order(count);
+            for (int i = 0; i < count; ++i) order[i] = i;
+            std::sort(order.begin(), order.end(), [&](int a, int b) {
+                return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+            });
+            std::set<int> class_set(class_ids.begin(), class_ids.end());
+            for (int c : class_set) RefNmsClass(count, boxes, class_ids, order, c, NMS_THRESH);
+            ref.clear();
+            for (int i = 0; i < count && (int)ref.size() < OBJ_NUMB_MAX_SIZE; ++i) {
+                if (order[i] != -1) ref.push_back(order[i]);
+            }
+        }
+    });
+
+    NmsEngine engine;
+    std::vector<int> keep;
+    std::vector<float> keep_scores;
+    double fast_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            engine.run(boxes.data(), scores.data(), class_ids.data(), count, keep, keep_scores);
+        }
+    });
+
+    NmsParams matrix;
+    matrix.mode = NmsMode::Matrix;
+    matrix.score_threshold = 0.05f;
+    engine.set_params(matrix);
+    double matrix_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) {
+            engine.run(boxes.data(), scores.data(), class_ids.data(), count, keep, keep_scores);
+        }
+    });
+    engine.set_params(NmsParams());
+    engine.run(boxes.data(), scores.data(), class_ids.data(), count, keep, keep_scores);
+
+    std::cout << "[NMS       ] " << count << " boxes, " << classes << " classes"
+              << " | Per-class scan: " << ref_ms / REPEAT << " ms"
+              << " | Buckets: " << fast_ms / REPEAT << " ms"
+              << " | Speedup: " << ref_ms / fast_ms << "x"
+              << " | Matrix: " << matrix_ms / REPEAT << " ms"
+              << " | Match: " << (ref == keep ? "yes" : "NO") << std::endl;
+}
+
+// --- 分类后处理: 逐 tile softmax + get_topk_with_indices vs classify_batch 整批一次 ---
+void RunClassifyBatch(int rows, int cols) {
+    std::vector<float> logits((size_t)rows * cols), work(logits.size());
+    uint32_t seed = 2024;
+    for (auto& v : logits) {
+        seed = seed * 1664525u + 1013904223u;
+        v = (float)(seed >> 8) / (1 << 24) * 12.f - 6.f;
+    }
+    std::vector<int> ids(rows);
+    for (int i = 0; i < rows; ++i) ids[i] = i;
+    std::vector<resnet_results> ref(rows), fast(rows);
+    int repeat = std::max(1, 200000 / (rows * cols)) * REPEAT;
+
+    double tile_ms = TimeMs([&]() {
+        for (int r = 0; r < repeat; ++r) {
+            memcpy(work.data(), logits.data(), logits.size() * sizeof(float));
+            for (int i = 0; i < rows; ++i) {
+                float* row = work.data() + (size_t)i * cols;
+                softmax(row, cols);
+                get_topk_with_indices(row, cols, ref[i]);
+                ref[i].id = i;
+            }
+        }
+    });
+    double batch_ms = TimeMs([&]() {
+        for (int r = 0; r < repeat; ++r) {
+            classify_batch(logits.data(), rows, cols, ids.data(), fast.data());
+        }
+    });
+
+    int mismatched = 0;
+    float max_diff = 0.f;
+    for (int i = 0; i < rows; ++i) {
+        mismatched += ref[i].result[0].cls != fast[i].result[0].cls || ref[i].id != fast[i].id;
+        max_diff = std::max(max_diff, std::fabs(ref[i].result[0].score - fast[i].result[0].score));
+    }
+    std::cout << "[Classify  ] " << rows << "x" << cols
+              << " | Per tile: " << tile_ms / repeat << " ms"
+              << " | Batch: " << batch_ms / repeat << " ms"
+              << " | Speedup: " << tile_ms / batch_ms << "x"
+              << " | Mismatch: " << mismatched << " | Max score diff: " << max_diff << std::endl;
+}
+
+// --- int8 输出分类: 反量化成 float 后 softmax + top-k (want_float 路径) vs 整数域 argmax ---
+void RunInt8Argmax(int rows, int cols) {
+    const int32_t zp = -14;
+    const float scale = 0.0625f;
+    std::vector<int8_t> q((size_t)rows * cols);
+    uint32_t seed = 99;
+    for (auto& v : q) {
+        seed = seed * 1664525u + 1013904223u;
+        v = (int8_t)(seed >> 24);
+    }
+    std::vector<float> f(q.size());
+    std::vector<resnet_results> ref(rows), fast(rows), bare(rows);
+    float table[256];
+    build_exp_table_i8(scale, table);
+    int repeat = std::max(1, 200000 / (rows * cols)) * REPEAT;
+
+    double float_ms = TimeMs([&]() {
+        for (int r = 0; r < repeat; ++r) {
+            for (size_t i = 0; i < q.size(); ++i) f[i] = (q[i] - zp) * scale;
+            for (int i = 0; i < rows; ++i) {
+                float* row = f.data() + (size_t)i * cols;
+                softmax(row, cols);
+                get_topk_with_indices(row, cols, ref[i]);
+            }
+        }
+    });
+    double prob_ms = TimeMs([&]() {
+        for (int r = 0; r < repeat; ++r) {
+            classify_batch_i8(q.data(), rows, cols, scale, table, nullptr, fast.data());
+        }
+    });
+    double bare_ms = TimeMs([&]() {
+        for (int r = 0; r < repeat; ++r) {
+            classify_batch_i8(q.data(), rows, cols, scale, nullptr, nullptr, bare.data());
+        }
+    });
+
+    int mismatched = 0;
+    float max_diff = 0.f;
+    for (int i = 0; i < rows; ++i) {
+        mismatched += ref[i].result[0].cls != fast[i].result[0].cls || fast[i].result[0].cls != bare[i].result[0].cls;
+        max_diff = std::max(max_diff, std::fabs(ref[i].result[0].score - fast[i].result[0].score));
+    }
+    std::cout << "[Int8Argmax] " << rows << "x" << cols
+              << " | Dequant+softmax: " << float_ms / repeat << " ms"
+              << " | Int8+prob: " << prob_ms / repeat << " ms (" << float_ms / prob_ms << "x)"
+              << " | Int8 only: " << bare_ms / repeat << " ms (" << float_ms / bare_ms << "x)"
+              << " | Mismatch: " << mismatched << " | Max score diff: " << max_diff << std::endl;
+}
+
+// --- 按 RST 分带并行解码 vs 整图 imdecode, 结果必须逐像素一致 ---
+void RunBandDecode(int width, int height, int restart_interval) {
+    std::vector<uint8_t> data;
+    cv::imencode(".jpg", MakeFrame(width, height), data,
+                 {cv::IMWRITE_JPEG_QUALITY, 90, cv::IMWRITE_JPEG_RST_INTERVAL, restart_interval});
+    PaddlePool::ThreadPool pool(std::max((int)std::thread::hardware_concurrency(), 1));
+    int bands = std::max((int)std::thread::hardware_concurrency(), 1) + 1;
+
+    cv::Mat full, banded;
+    double full_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) full = cv::imdecode(data, cv::IMREAD_COLOR);
+    }) / REPEAT;
+    double band_ms = TimeMs([&]() {
+        for (int r = 0; r < REPEAT; ++r) banded = decode_jpeg_bands(data, pool, bands);
+    }) / REPEAT;
+
+    long long mismatched = -1;
+    if (!banded.empty() && banded.rows == full.rows && banded.cols == full.cols && banded.type() == full.type()) {
+        mismatched = 0;
+        for (int y = 0; y < full.rows; ++y) {
+            mismatched += memcmp(full.ptr<uint8_t>(y), banded.ptr<uint8_t>(y), full.cols * full.elemSize()) != 0;
+        }
+    }
+    std::cout << "[BandDecode] " << width << "x" << height << " RST " << restart_interval
+              << " | imdecode: " << full_ms << " ms"
+              << " | Banded(" << bands << "): " << band_ms << " ms"
+              << " | Mismatched rows: " << (mismatched < 0 ? std::string("unsupported") : std::to_string(mismatched))
+              << std::endl;
+}
+
+// --- 逐行数据源经 BandBufferSource 按行带取 tile: 与整图 crop_tile 逐像素一致, 驻留行数只与在途行带有关 ---
+// 预测器是同步的校验桩: tile 与整图上同位置的 crop_tile 一致时 cls 为 1
+struct CropCheckPredictor {
+    const cv::Mat* frame;
+    const TileLayout* layout;
+    std::future<resnet_results> PredictAsync(const resnet_input& input) {
+        cv::Mat expect = crop_tile(*frame, *layout, layout->row_of(input.id), layout->col_of(input.id));
+        bool same = input.img.rows == expect.rows && input.img.cols == expect.cols;
+        for (int y = 0; same && y < expect.rows; ++y) {
+            same = memcmp(input.img.ptr<uint8_t>(y), expect.ptr<uint8_t>(y), expect.cols * 3) == 0;
+        }
+        resnet_results res = resnet_results();
+        res.id = input.id;
+        res.result[0].cls = same ? 1 : 0;
+        std::promise<resnet_results> promise;
+        promise.set_value(res);
+        return promise.get_future();
+    }
+};
+
+void RunBandBuffer(int width, int height, const TilingSpec& spec) {
+    cv::Mat frame = MakeFrame(width, height);
+    TileLayout layout = spec.resolve(width, height);
+    CropCheckPredictor predictor{&frame, &layout};
+
+    int tiles = 0, wrong = 0;
+    size_t peak_rows = 0;
+    double band_ms = TimeMs([&]() {
+        MatRowSource rows(frame);
+        BandBufferSource source(rows);
+        stream_tiles(source, predictor, spec, [&](const resnet_results& res) {
+            tiles++;
+            wrong += res.result[0].cls != 1;
+        });
+        peak_rows = source.peak_rows();
+    });
+
+    std::cout << "[BandBuffer] " << width << "x" << height << " " << layout.rows << "x" << layout.cols
+              << " | Stream tiles: " << band_ms << " ms"
+              << " | Tiles: " << tiles << " / " << layout.count()
+              << " | Peak rows: " << peak_rows << " / " << height
+              << " | Wrong: " << wrong << std::endl;
+}
+
+// --- 时间线追踪: 每个 scope 在运行时关闭 / 打开时的开销 ---
+void RunTrace() {
+    const int n = 1 << 20;
+    volatile int sink = 0;
+    PaddlePool::trace::set_enabled(false);
+    double base_ms = TimeMs([&]() {
+        for (int i = 0; i < n; ++i) sink = sink + 1;
+    });
+    double off_ms = TimeMs([&]() {
+        for (int i = 0; i < n; ++i) {
+            PP_TRACE_SCOPE("bench");
+            sink = sink + 1;
+        }
+    });
+    PaddlePool::trace::set_enabled(true);
+    double on_ms = TimeMs([&]() {
+        for (int i = 0; i < n; ++i) {
+            PP_TRACE_SCOPE("bench");
+            sink = sink + 1;
+        }
+    });
+    PaddlePool::trace::set_enabled(false);
+    uint64_t dropped = PaddlePool::trace::dropped();
+    PaddlePool::trace::clear();
+    std::cout << "[Trace     ] " << n << " scopes"
+              << " | Disabled: " << (off_ms - base_ms) * 1e6 / n << " ns/scope"
+              << " | Enabled: " << (on_ms - base_ms) * 1e6 / n << " ns/scope"
+              << " | Dropped: " << dropped << std::endl;
+}
+
+int main() {
+    std::cout << "=== Micro Benchmarks (" << FRAME_W << "x" << FRAME_H << ", "
+              << ROWS << "x" << COLS << " tiles) ===" << std::endl;
+
+    RunPreprocess();
+    RunBatchPack(COLS);
+    RunClassMap();
+    RunCompose(ROWS, COLS, FRAME_W, FRAME_H);
+    RunCompose(ROWS * 2, COLS * 2, FRAME_W * 2, FRAME_H * 2);
+    RunCompose(ROWS * 4, COLS * 4, FRAME_W * 4, FRAME_H * 4);
+    RunTileFilter();
+    RunResultCache();
+    RunBandDecode(FRAME_W, FRAME_H, FRAME_W / 16);
+    RunBandBuffer(FRAME_W, FRAME_H, TilingSpec());
+    RunBandBuffer(FRAME_W * 4, FRAME_H * 4, TilingSpec::window(256, 256, 0, 0, BorderPolicy::Pad));
+    RunBandDecode(FRAME_W * 2, FRAME_H * 2, 7);
+    RunSoftmax(1, 5);
+    RunSoftmax(ROWS * COLS, 5);
+    RunSoftmax(64, 1000);
+    RunTopK(ROWS * COLS, 5, CLASS_NUM);
+    RunTopK(64, 1000, CLASS_NUM);
+    RunTopK(64, 1000, 5);
+    RunTopK(64, 1000, 100);
+    RunYoloScan(80, 0.001f);
+    RunYoloScan(80, 0.02f);
+    RunYoloScan(20, 0.2f);
+    RunNms(500, 10);
+    RunNms(3000, 80);
+    RunNms(3000, 3);
+    RunPostProcess(640, 0.002f, 4, 50);
+    RunPostProcess(640, 0.05f, 4, 50);
+    RunClassifyBatch(ROWS * COLS, 5);
+    RunClassifyBatch(COLS + 3, 5);
+    RunClassifyBatch(64, 1000);
+    RunInt8Argmax(ROWS * COLS, 5);
+    RunInt8Argmax(64, 1000);
+    RunTrace();
+
+    std::cout << "==========================================================" << std::endl;
+    return 0;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <deque>
+#include <future>
+#include <utility>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "const.hpp"
+#include "tiling.hpp"
+#include "class_map.hpp"
+
+struct CascadeParams
+{
+    // 由粗到细的各级网格, 最后一级即输出网格
+    std::vector<TilingSpec> levels = {TilingSpec::grid(4, 7), TilingSpec::grid(ROWS, COLS)};
+    float min_score = 0.6f;          // top-1 分数低于它的格子细分
+    bool refine_boundaries = true;   // 与相邻格子类别不同时两侧都细分
+};
+
+struct CascadeStats
+{
+    std::vector<int> cells;      // 每级格子总数
+    std::vector<int> inferred;   // 每级实际推理的格子数
+
+    int total_inferred() const;
+};
+
+// 级联的簿记部分, 与预测器无关. 第 L+1 级格子的父格是中心点落在其中的第 L 级格子,
+// 未推理的格子沿用父格的类别和分数. 结果须按提交顺序 (先进先出) 交回, 这样处理第 L+1 级
+// 结果时第 L 级已全部就绪, 相邻格子的比较不会遗漏.
+class CascadePlan
+{
+public:
+    CascadePlan(int img_w, int img_h, const CascadeParams &params = CascadeParams());
+
+    int levels() const { return (int)layouts_.size(); }
+    const TileLayout &layout(int level) const { return layouts_[level]; }
+    // 首批提交: 第 0 级全部格子
+    std::vector<std::pair<int, int>> initial() const;
+    // 交回格子 (level, id) 的结果, 把因此需要细分出的 (level, id) 追加到 submit.
+    // id 以提交时为准, 不读 result.id; cls 为 NO_LABEL 视为推理失败, 交给下一级
+    void on_result(int level, int id, const resnet_results &result, std::vector<std::pair<int, int>> &submit);
+    // 最细一级的类别网格
+    ClassMap result() const;
+    CascadeStats stats() const;
+
+private:
+    struct Level
+    {
+        std::vector<int> parent;          // 上一级父格 id, 第 0 级为 -1
+        std::vector<int> child_begin;     // 子格在 children 中的区间, 长度为格子数 + 1
+        std::vector<int> children;
+        std::vector<int16_t> label;       // 推理得到的类别, 未推理为 NO_LABEL
+        std::vector<float> score;
+        std::vector<char> refined;        // 子格是否已提交
+        int inferred = 0;
+    };
+
+    void refine(int level, int id, std::vector<std::pair<int, int>> &submit);
+    // 推理结果或逐级向上继承的类别, 父格尚未就绪时为 NO_LABEL
+    int effective_label(int level, int id, float *score = nullptr) const;
+
+    CascadeParams params_;
+    std::vector<TileLayout> layouts_;
+    std::vector<Level> levels_;
+};
+
+// 依赖式提交: 先提交粗网格, 每取回一个结果立即提交它需要细分的子格, 子格结果再决定下一级.
+template <typename AutoPredictor>
+ClassMap predict_cascade(AutoPredictor &predictor, const cv::Mat &image, const CascadeParams &params = CascadeParams(),
+                         CascadeStats *stats = nullptr)
+{
+    CascadePlan plan(image.cols, image.rows, params);
+    std::deque<std::pair<std::pair<int, int>, std::future<resnet_results>>> pending;
+    auto submit_all = [&](const std::vector<std::pair<int, int>> &cells) {
+        for (const auto &cell : cells) {
+            const TileLayout &layout = plan.layout(cell.first);
+            cv::Mat tile = crop_tile(image, layout, layout.row_of(cell.second), layout.col_of(cell.second));
+            pending.emplace_back(cell, predictor.PredictAsync(resnet_input(tile, cell.second)));
+        }
+    };
+
+    submit_all(plan.initial());
+    std::vector<std::pair<int, int>> submit;
+    while (!pending.empty()) {
+        auto cell = pending.front().first;
+        resnet_results result;
+        try {
+            result = pending.front().second.get();
+        } catch (const std::exception &e) {
+            // 推理失败的格子视为不确定, 交给下一级
+            result.id = cell.second;
+            result.result[0].cls = ClassMap::NO_LABEL;
+            result.result[0].score = 0.f;
+            result.result[0].margin = 0.f;
+        }
+        pending.pop_front();
+
+        submit.clear();
+        plan.on_result(cell.first, cell.second, result, submit);
+        submit_all(submit);
+    }
+
+    if (stats) {
+        *stats = plan.stats();
+    }
+    return plan.result();
+}
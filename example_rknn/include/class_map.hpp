@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "const.hpp"
+#include "tiling.hpp"
+#include "thread_pool.h"
+
+// ROWS x COLS 的分类结果网格, 每个 tile 只存类别和分数 (约 6 字节).
+// 需要图像时再按需渲染, 渲染所需像素来自调用方传入的 tile (父图 ROI), 本身不持有像素.
+class ClassMap
+{
+public:
+    static constexpr int16_t NO_LABEL = -1;
+
+    ClassMap(int rows = ROWS, int cols = COLS);
+
+    // 按 resnet_results::id 填充网格, 越界 id 会被忽略并打印
+    static ClassMap from_results(const std::vector<resnet_results> &results, int rows = ROWS, int cols = COLS);
+
+    void set(int id, int cls, float score);
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    int label(int row, int col) const { return labels_[row * cols_ + col]; }
+    float score(int row, int col) const { return scores_[row * cols_ + col]; }
+    const std::vector<int16_t> &labels() const { return labels_; }
+    const std::vector<float> &scores() const { return scores_; }
+    int count(int cls) const;
+
+    // rows x cols 的 CV_8UC1 类别图, 无结果的格子为 255
+    cv::Mat label_image() const;
+
+    // 只把类别为 cls 的 tile 拷贝到全尺寸画布, 其余为黑色, 与原 synthesize_image()[cls] 相同.
+    // 不带 layout 时按 rows x cols 等分网格摆放, tile 尺寸取 inputs[0]
+    cv::Mat render_class(const std::vector<resnet_input> &inputs, int cls) const;
+    cv::Mat render_class(const std::vector<resnet_input> &inputs, int cls, const TileLayout &layout) const;
+
+    // 全尺寸调色板图, 每个 tile 用其类别的颜色填充, 一张图展示所有类别
+    cv::Mat render_palette(const std::vector<resnet_input> &inputs) const;
+    cv::Mat render_palette(const TileLayout &layout) const;
+
+    // rows x cols 等分网格, tile 尺寸取 inputs[0]; 供不带 layout 的重载使用
+    bool uniform_layout(const std::vector<resnet_input> &inputs, TileLayout &layout) const;
+
+private:
+
+    int rows_, cols_;
+    std::vector<int16_t> labels_;
+    std::vector<float> scores_;
+};
+
+// 并行合成器: 按画布像素行分段, 多个类别画布并行渲染到调用方复用的输出缓冲.
+// tile 通过指针表访问, 不拷贝 cv::Mat (无引用计数原子操作); tile 位置取自 TileLayout,
+// 等分网格时每条目标行按列顺序写入 tile 像素或清零, 每个目标缓存行只写一次;
+// Shift / Pad 布局先清零再按 id 顺序贴 tile, 重叠处后面的 tile 覆盖前面的, 与 render_class 一致.
+// 输出尺寸不变时不重新分配. 同一对象不能被多个线程同时使用.
+class ClassCompositor
+{
+public:
+    explicit ClassCompositor(int threads = 0);   // 0 表示使用全部硬件线程
+
+    // outputs[k] 渲染 classes[k], 等价于 map.render_class(inputs, classes[k], layout)
+    bool render(const ClassMap &map, const std::vector<resnet_input> &inputs, const TileLayout &layout,
+                const std::vector<int> &classes, std::vector<cv::Mat> &outputs);
+    // 按 rows x cols 等分网格摆放, tile 尺寸取 inputs[0], 等价于 map.render_class(inputs, classes[k])
+    bool render(const ClassMap &map, const std::vector<resnet_input> &inputs,
+                const std::vector<int> &classes, std::vector<cv::Mat> &outputs);
+
+private:
+    void render_band(const ClassMap &map, const TileLayout &layout, const std::vector<int> &classes,
+                     std::vector<cv::Mat> &outputs, int y_begin, int y_end) const;
+
+    int threads_;
+    std::unique_ptr<PaddlePool::ThreadPool> pool_;
+    std::vector<const uint8_t *> tile_data_;   // 下标为 tile id, 空指针表示缺失
+    std::vector<size_t> tile_step_;
+    std::vector<std::future<void>> pending_;
+};
@@ -7,6 +7,7 @@
 
 
 
+// 默认切分网格, 运行时可用 TilingSpec (tiling.hpp) 覆盖, 不必重新编译
 // #define ROWS  4
 // #define COLS  7
 
@@ -29,6 +30,7 @@ struct element_t{
 struct resnet_result {
     int cls;
     float score;
+    float margin;   // 第一名与第二名 logit 之差, 仅 int8 argmax 路径填写, 其余为 0
 } ;
 
 struct resnet_results
@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 #include <tuple>
+#include <atomic>
+#include <stdint.h>
 #include <time.h>
 
 
@@ -29,13 +31,73 @@ namespace iLogger{
         Fatal   = 0
     };
 
-    #define INFOD(...)			iLogger::__log_func(__FILE__, __LINE__, iLogger::LogLevel::Debug, __VA_ARGS__)
-    #define INFOV(...)			iLogger::__log_func(__FILE__, __LINE__, iLogger::LogLevel::Verbose, __VA_ARGS__)
-    #define INFO(...)			iLogger::__log_func(__FILE__, __LINE__, iLogger::LogLevel::Info, __VA_ARGS__)
-    #define INFOW(...)			iLogger::__log_func(__FILE__, __LINE__, iLogger::LogLevel::Warning, __VA_ARGS__)
-    #define INFOE(...)			iLogger::__log_func(__FILE__, __LINE__, iLogger::LogLevel::Error, __VA_ARGS__)
+    // 编译期最低日志级别 (LogLevel 的数值, 默认 5 即 Debug 全部保留). 高于它的调用连同参数求值一起被编译掉,
+    // 例如 -DILOGGER_MIN_LEVEL=3 时 INFOD / INFOV 不产生任何代码. Fatal 永远保留
+    #ifndef ILOGGER_MIN_LEVEL
+    #define ILOGGER_MIN_LEVEL 5
+    #endif
+
+    // 运行时级别的副本, 宏在求值参数之前先比较它
+    extern std::atomic<int> __log_level;
+    long long __log_clock_ms();
+
+    #define ILOGGER_ENABLED(level)  ((int)(level) <= ILOGGER_MIN_LEVEL && (int)(level) <= iLogger::__log_level.load(std::memory_order_relaxed))
+
+    #define ILOGGER_LOG(level, ...) \
+        do { if (ILOGGER_ENABLED(level)) iLogger::__log_func(__FILE__, __LINE__, level, __VA_ARGS__); } while (0)
+
+    // 每个调用点独立计数: 第 1, n+1, 2n+1 ... 次输出
+    #define ILOGGER_LOG_EVERY_N(level, n, ...) \
+        do { \
+            if (ILOGGER_ENABLED(level)) { \
+                static std::atomic<uint64_t> __ilogger_count{0}; \
+                if (__ilogger_count.fetch_add(1, std::memory_order_relaxed) % (uint64_t)(n) == 0) \
+                    iLogger::__log_func(__FILE__, __LINE__, level, __VA_ARGS__); \
+            } \
+        } while (0)
+
+    // 每个调用点每 ms 毫秒至多输出一次, 并发时只有抢到时间戳的线程输出
+    #define ILOGGER_LOG_EVERY_MS(level, ms, ...) \
+        do { \
+            if (ILOGGER_ENABLED(level)) { \
+                static std::atomic<long long> __ilogger_last{-(1LL << 62)}; \
+                long long __ilogger_now = iLogger::__log_clock_ms(); \
+                long long __ilogger_prev = __ilogger_last.load(std::memory_order_relaxed); \
+                if (__ilogger_now - __ilogger_prev >= (ms) && \
+                    __ilogger_last.compare_exchange_strong(__ilogger_prev, __ilogger_now, std::memory_order_relaxed)) \
+                    iLogger::__log_func(__FILE__, __LINE__, level, __VA_ARGS__); \
+            } \
+        } while (0)
+
+    // 每个调用点只输出前 n 次
+    #define ILOGGER_LOG_FIRST_N(level, n, ...) \
+        do { \
+            if (ILOGGER_ENABLED(level)) { \
+                static std::atomic<uint64_t> __ilogger_count{0}; \
+                if (__ilogger_count.load(std::memory_order_relaxed) < (uint64_t)(n) && \
+                    __ilogger_count.fetch_add(1, std::memory_order_relaxed) < (uint64_t)(n)) \
+                    iLogger::__log_func(__FILE__, __LINE__, level, __VA_ARGS__); \
+            } \
+        } while (0)
+
+    #define INFOD(...)			ILOGGER_LOG(iLogger::LogLevel::Debug, __VA_ARGS__)
+    #define INFOV(...)			ILOGGER_LOG(iLogger::LogLevel::Verbose, __VA_ARGS__)
+    #define INFO(...)			ILOGGER_LOG(iLogger::LogLevel::Info, __VA_ARGS__)
+    #define INFOW(...)			ILOGGER_LOG(iLogger::LogLevel::Warning, __VA_ARGS__)
+    #define INFOE(...)			ILOGGER_LOG(iLogger::LogLevel::Error, __VA_ARGS__)
     #define INFOF(...)			iLogger::__log_func(__FILE__, __LINE__, iLogger::LogLevel::Fatal, __VA_ARGS__)
 
+    // 循环 / 热路径中使用的限频版本
+    #define INFO_EVERY_N(n, ...)		ILOGGER_LOG_EVERY_N(iLogger::LogLevel::Info, n, __VA_ARGS__)
+    #define INFO_EVERY_MS(ms, ...)		ILOGGER_LOG_EVERY_MS(iLogger::LogLevel::Info, ms, __VA_ARGS__)
+    #define INFO_FIRST_N(n, ...)		ILOGGER_LOG_FIRST_N(iLogger::LogLevel::Info, n, __VA_ARGS__)
+    #define INFOW_EVERY_N(n, ...)		ILOGGER_LOG_EVERY_N(iLogger::LogLevel::Warning, n, __VA_ARGS__)
+    #define INFOW_EVERY_MS(ms, ...)		ILOGGER_LOG_EVERY_MS(iLogger::LogLevel::Warning, ms, __VA_ARGS__)
+    #define INFOW_FIRST_N(n, ...)		ILOGGER_LOG_FIRST_N(iLogger::LogLevel::Warning, n, __VA_ARGS__)
+    #define INFOE_EVERY_N(n, ...)		ILOGGER_LOG_EVERY_N(iLogger::LogLevel::Error, n, __VA_ARGS__)
+    #define INFOE_EVERY_MS(ms, ...)		ILOGGER_LOG_EVERY_MS(iLogger::LogLevel::Error, ms, __VA_ARGS__)
+    #define INFOE_FIRST_N(n, ...)		ILOGGER_LOG_FIRST_N(iLogger::LogLevel::Error, n, __VA_ARGS__)
+
     string date_now();
     string time_now();
     string gmtime_now();
@@ -90,6 +152,30 @@ namespace iLogger{
     const char* level_string(LogLevel level);
     void set_logger_save_directory(const string& loggerDirectory);
 
+    // 每个写日志的线程有一个无锁环形缓冲, 刷新线程负责输出到终端和文件; 环满时丢弃并计数.
+    // 只影响之后新建的环, 按 2 的幂向上取整, 默认 64 KB
+    void set_logger_ring_size(size_t bytes);
+    uint64_t logger_dropped_count();
+
+    // 刷新线程写文件的周期, 默认 1000 ms. 终端输出仍至少每 100 ms 取一次
+    void set_logger_flush_interval(int ms);
+    // 单个日志文件超过 max_file_bytes 后切到 <date>.1.txt, <date>.2.txt ..., 0 表示只按日期切换;
+    // preallocate_bytes 为每次预分配的磁盘空间 (Linux fallocate, 不改变文件长度), 0 表示关闭
+    void set_logger_rotation(size_t max_file_bytes, size_t preallocate_bytes = 4 * 1024 * 1024);
+
+    // 刷新线程的累计文件 I/O 开销
+    struct LoggerIOStats{
+        uint64_t lines = 0;       // 写入文件的行数
+        uint64_t bytes = 0;
+        uint64_t flushes = 0;     // 有数据落盘的刷新次数
+        uint64_t syscalls = 0;    // writev / fallocate 调用次数
+        uint64_t files = 0;       // 打开过的文件数 (含轮转)
+        uint64_t dropped = 0;     // 环满丢弃的行数
+        double drain_ms = 0;      // 取环 + 格式化耗时
+        double io_ms = 0;         // 打开文件 + 预分配 + 写入耗时
+    };
+    LoggerIOStats logger_io_stats();
+
     void set_log_level(LogLevel level);
     LogLevel get_log_level();
     void __log_func(const char* file, int line, LogLevel level, const char* fmt, ...);
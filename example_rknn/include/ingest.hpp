@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "thread_pool.h"
+
+// 定长阻塞队列: 满时 push 等待, 空时 pop 等待, close() 后两者立即返回 false (pop 先取完剩余元素)
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_full_.wait(lock, [this]() { return closed_ || items_.size() < capacity_; });
+        if (closed_) return false;
+        items_.push(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool pop(T &out)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_empty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        out = std::move(items_.front());
+        items_.pop();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    bool closed_ = false;
+    std::queue<T> items_;
+    std::mutex mtx_;
+    std::condition_variable not_full_, not_empty_;
+};
+
+// 按重启标记 (RST) 把基线 JPEG 切成若干行带, 每带拼成独立的 JPEG 码流在线程池上并行解码.
+// 要求: 单次扫描的基线/扩展霍夫曼 JPEG, 设置了 DRI 且重启间隔能落在 MCU 行边界上, 无 EXIF
+// (分带解码无法统一处理方向). 不满足时返回空 Mat, 由调用方退回整图解码.
+// 每带多解上下相邻的一段重启间隔作为色度上采样的上下文, 结果与整图解码逐像素一致.
+cv::Mat decode_jpeg_bands(const std::vector<uint8_t> &data, PaddlePool::ThreadPool &pool, int bands);
+
+// 读取单张图像: JPEG 能分带时并行解码, 否则 cv::imdecode. bands 为 0 时取线程池上限 + 1 (调用线程也解一带)
+cv::Mat read_image_parallel(const std::string &path, PaddlePool::ThreadPool &pool, int bands = 0);
+
+struct DecodedFrame
+{
+    int index = -1;        // 在提交顺序中的位置
+    std::string path;
+    cv::Mat image;         // 解码失败时为空
+};
+
+// 目录 / 批量输入的解码级: 多张图像在自己的线程池上并发解码, 按完成顺序放入定长队列交给切图.
+// 队列满时解码线程等待, 内存中至多 capacity + threads 帧.
+class DecodeStage
+{
+public:
+    explicit DecodeStage(int threads = 0, size_t capacity = 4);
+    ~DecodeStage();
+    DecodeStage(const DecodeStage &) = delete;
+    DecodeStage &operator=(const DecodeStage &) = delete;
+
+    void submit(const std::vector<std::string> &paths);
+    // 取下一帧, 已提交的图像全部取走后返回 false
+    bool next(DecodedFrame &out);
+
+private:
+    std::unique_ptr<PaddlePool::ThreadPool> pool_;
+    BoundedQueue<DecodedFrame> queue_;
+    int submitted_ = 0;
+    int delivered_ = 0;
+};
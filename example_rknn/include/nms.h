@@ -0,0 +1,66 @@
+#ifndef _RKNN_DEMO_NMS_H_
+#define _RKNN_DEMO_NMS_H_
+
+#include <stdint.h>
+#include <vector>
+
+// 检测框的非极大值抑制. 框先按类别一次性分桶 (class_agnostic 时只有一个桶), 每个桶按分数降序排好,
+// 坐标按桶连续存成 SoA, IoU 以一对多的方式向量化 (NEON / AVX2 / SSE2).
+//   Hard:   经典贪心 NMS. 各桶的当前最高分框放进一个堆, 按全局分数顺序逐个确认并抑制本桶剩余框,
+//           凑满 max_output 个即停止, 其余桶不再处理
+//   Matrix: Matrix-NMS (SOLOv2), 不删除框而是按与更高分框的 IoU 衰减分数, 衰减后低于 score_threshold 的丢弃
+// IoU 与原 CalculateOverlap 一致, 宽高按像素计 +1.
+enum class NmsMode
+{
+    Hard,
+    Matrix
+};
+
+struct NmsParams
+{
+    NmsMode mode = NmsMode::Hard;
+    float iou_threshold = 0.45f;   // 同 NMS_THRESH, 仅 Hard
+    int max_output = 64;           // 同 OBJ_NUMB_MAX_SIZE, <= 0 表示不限
+    bool class_agnostic = false;   // 不同类别的框也互相抑制
+    bool matrix_gaussian = false;  // Matrix 的衰减函数: false 为线性 1 - iou, true 为 exp(-sigma * iou^2)
+    float matrix_sigma = 2.0f;
+    float score_threshold = 0.f;   // 仅 Matrix, 衰减后分数的下限
+};
+
+class NmsEngine
+{
+public:
+    explicit NmsEngine(const NmsParams &params = NmsParams());
+
+    const NmsParams &params() const { return params_; }
+    void set_params(const NmsParams &params) { params_ = params; }
+
+    // boxes 为 count 个 (x, y, w, h), class_ids 为非负类别号.
+    // 保留框的原下标按最终分数降序 (同分时下标小的在前) 写入 keep, 最终分数写入 keep_scores
+    // (Hard 下即原分数, Matrix 下为衰减后的分数). 返回保留个数.
+    int run(const float *boxes, const float *scores, const int *class_ids, int count,
+            std::vector<int> &keep, std::vector<float> &keep_scores);
+
+private:
+    void bucket(const float *boxes, const float *scores, const int *class_ids, int count);
+    int run_hard(std::vector<int> &keep, std::vector<float> &keep_scores);
+    int run_matrix(std::vector<int> &keep, std::vector<float> &keep_scores);
+
+    NmsParams params_;
+
+    // 以下为复用的工作区, 按桶连续存放, 桶 b 占 [offset_[b], offset_[b + 1])
+    std::vector<int> offset_;
+    std::vector<int> cursor_;
+    std::vector<int> heap_;
+    std::vector<int> order_;       // 排序后位置 -> 原下标
+    std::vector<float> score_;
+    std::vector<float> x1_, y1_, x2_, y2_, area_;
+    std::vector<uint8_t> removed_;
+    std::vector<float> iou_, decay_, compensate_;
+};
+
+// boxes 中第 i 个框与 [begin, end) 各框的 IoU, SoA 坐标为 (x1, y1, x2, y2, area)
+void iou_one_to_many(const float *x1, const float *y1, const float *x2, const float *y2, const float *area,
+                     int i, int begin, int end, float *iou);
+
+#endif //_RKNN_DEMO_NMS_H_
@@ -2,8 +2,12 @@
 #define _RKNN_YOLOV5_DEMO_POSTPROCESS_H_
 
 #include <stdint.h>
+#include <memory>
+#include <string>
 #include <vector>
 #include "const.hpp"
+#include "tiling.hpp"
+#include "nms.h"
 
 #define OBJ_NAME_MAX_SIZE 16
 #define OBJ_NUMB_MAX_SIZE 64
@@ -11,6 +15,7 @@
 #define NMS_THRESH 0.45
 #define BOX_THRESH 0.25
 #define PROP_BOX_SIZE (5 + OBJ_CLASS_NUM)
+#define LABEL_NALE_TXT_PATH "./model/coco_80_labels_list.txt"
 
 typedef struct _BOX_RECT
 {
@@ -39,13 +44,80 @@ int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h,
                  std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
                  detect_result_group_t *group);
 
+// 同上, NMS 的方式 (Hard / Matrix, 是否跨类别) 由 nms_params 指定, 输出个数不超过 OBJ_NUMB_MAX_SIZE
+int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w,
+                 float conf_threshold, BOX_RECT pads, float scale_w, float scale_h,
+                 std::vector<int32_t> &qnt_zps, std::vector<float> &qnt_scales,
+                 detect_result_group_t *group, const NmsParams &nms_params);
+
+// 释放默认标签表. 已持有它的 PostProcessContext 不受影响, 之后新建的上下文会重新加载
 void deinitPostProcess();
 
+// 只读的类别名表, 加载后可被多个上下文共享
+struct LabelTable
+{
+    std::vector<std::string> names;
+
+    const char *name(int id) const;   // 越界返回 ""
+    static std::shared_ptr<const LabelTable> load(const char *path);   // 打开失败返回 nullptr
+    static std::shared_ptr<const LabelTable> shared();                 // LABEL_NALE_TXT_PATH, 进程内只加载一次
+};
+
+// 一次检测后处理用到的缓冲区, clear 后保留容量
+struct DetectScratch
+{
+    std::vector<float> boxes;          // 每个候选 (x, y, w, h)
+    std::vector<float> probs;
+    std::vector<int> class_ids;
+    std::vector<int32_t> cells;        // 单个输出头上的候选网格
+    std::vector<int8_t> max_probs;
+    std::vector<uint8_t> max_ids;
+    std::vector<int> keep;             // NMS 保留的候选下标
+    std::vector<float> keep_probs;
+};
+
+// 检测后处理上下文: 标签只加载一次, 工作区随对象复用, 稳定运行后不再分配内存.
+// 对象本身不加锁, 每个线程 (或每个推理实例) 各持有一个, 多个上下文共享同一份只读标签表
+class PostProcessContext
+{
+public:
+    PostProcessContext();   // 首次 run 时取默认标签表
+    explicit PostProcessContext(std::shared_ptr<const LabelTable> labels);
+    PostProcessContext(const PostProcessContext &) = delete;
+    PostProcessContext &operator=(const PostProcessContext &) = delete;
+
+    // label_path 为空时使用默认标签表, 失败返回 -1
+    int init(const char *label_path = nullptr);
+    void set_nms_params(const NmsParams &params);   // max_output 被限制在 OBJ_NUMB_MAX_SIZE 以内
+
+    int run(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w,
+            float conf_threshold, BOX_RECT pads, float scale_w, float scale_h,
+            const std::vector<int32_t> &qnt_zps, const std::vector<float> &qnt_scales,
+            detect_result_group_t *group);
+
+private:
+    std::shared_ptr<const LabelTable> labels_;
+    NmsParams nms_params_;
+    NmsEngine engine_;
+    DetectScratch scratch_;
+};
+
 
 void get_topk_with_indices(float arr[], int size, resnet_results& result);
+void get_topk_reference(float arr[], int size, resnet_results& result);
 
 void softmax(float* array, int size);
+
+// 批量分类后处理: logits 为连续的 [n, classes], 一次完成 softmax 与 top-k, 写出 n 个结果.
+// ids 为空时 id 取批内序号. 与逐个 softmax + get_topk_with_indices 的结果一致
+void classify_batch(const float* logits, int n, int classes, const int* ids, resnet_results* out);
+
+// int8 量化 logits 的批量分类: 只求第一名和 margin, 不做反量化. exp_table 来自 build_exp_table_i8,
+// 为空时不计算概率, score 置 0. 只输出第一名, 其余名次的 cls 为 -1
+void classify_batch_i8(const int8_t* logits, int n, int classes, float scale, const float* exp_table,
+                       const int* ids, resnet_results* out);
 std::vector<cv::Mat> synthesize_image(std::vector<resnet_input>& inputs, std::vector<resnet_results>& results_vec);
+std::vector<cv::Mat> synthesize_image(std::vector<resnet_input>& inputs, std::vector<resnet_results>& results_vec, const TileLayout& layout);
 
 void GetMaxRect(const char* image ,const char* outimage,float height,float voc_level,float lat0,float lon0,float distance ,float pitch,float bearing);
 #endif //_RKNN_YOLOV5_DEMO_POSTPROCESS_H_
@@ -2,19 +2,63 @@
 #define _RKNN_YOLOV5_DEMO_PREPROCESS_H_
 
 #include <stdio.h>
+#include <stdint.h>
+#include <vector>
 #include "im2d.h"
 #include "rga.h"
 #include "opencv2/core/core.hpp"
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/imgproc.hpp"
 #include "postprocess.h"
-#include "rkResnet.hpp"
 
 
 void letterbox(const cv::Mat &image, cv::Mat &padded_image, BOX_RECT &pads, const float scale, const cv::Size &target_size, const cv::Scalar &pad_color = cv::Scalar(128, 128, 128));
 
 int resize_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::Mat &resized_image, const cv::Size &target_size);
 
+enum class ResizeInterp
+{
+    Nearest,
+    Bilinear
+};
+
+// 单趟完成 BGR->RGB + 缩放 + 写入 NHWC uint8, 替代 cvtColor + resize 两次整图拷贝.
+// 输入可以直接是父图上的 ROI (不要求连续); 双线性采用 7 位定点权重, 与 OpenCV 的
+// 像素中心对齐方式一致. 源尺寸不变时索引表和行缓存复用, 稳态下不分配内存.
+// 非线程安全, 每个推理实例持有一个.
+class FusedPreprocessor
+{
+public:
+    FusedPreprocessor() = default;
+    FusedPreprocessor(int dst_w, int dst_h, ResizeInterp interp = ResizeInterp::Bilinear);
+
+    void reset(int dst_w, int dst_h, ResizeInterp interp = ResizeInterp::Bilinear);
+
+    // src 必须是 CV_8UC3 BGR, dst 至少 dst_w * dst_h * 3 字节
+    bool run(const cv::Mat &src, uint8_t *dst);
+
+private:
+    void build_tables(int src_w, int src_h);
+    const uint16_t *horizontal_row(const cv::Mat &src, int sy, int slot);
+
+    int dst_w_ = 0, dst_h_ = 0;
+    int src_w_ = 0, src_h_ = 0;
+    ResizeInterp interp_ = ResizeInterp::Bilinear;
+
+    std::vector<int> xofs0_, xofs1_;   // 源像素的字节偏移
+    std::vector<uint8_t> xw_;          // 右侧像素权重, 0..128
+    std::vector<uint16_t> xw0_, xw1_;  // 左 / 右权重按像素展开 4 份, 供 SIMD 水平插值
+    int hsimd_w_ = 0;                  // 前 hsimd_w_ 个目标像素可以按 4 字节读源像素
+    std::vector<int> yofs_;
+    std::vector<uint8_t> yw_;
+    std::vector<uint16_t> rows_[2];    // 水平插值后的两行, 已交换通道
+    int row_tag_[2] = {-1, -1};
+};
+
+// 标量参考实现, 与 FusedPreprocessor 逐字节一致, 用于校验 SIMD 路径
+void fused_preprocess_reference(const cv::Mat &src, uint8_t *dst, int dst_w, int dst_h,
+                                ResizeInterp interp = ResizeInterp::Bilinear);
+
 
 
 
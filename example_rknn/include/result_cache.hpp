@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "const.hpp"
+#include "class_map.hpp"
+
+// xxHash64 风格的 tile 内容哈希, 尺寸参与混合.
+// ignore_low_bits > 0 时先抹掉每个字节的低位, 对传感器噪声有一定容忍
+uint64_t hash_tile(const cv::Mat &tile, int ignore_low_bits = 0);
+
+struct ResultCacheParams
+{
+    size_t capacity = ROWS * COLS * 4;   // 总条目数, 平均分给各分片
+    int shards = 16;                     // 分片数, 每片独立加锁
+    int ignore_low_bits = 0;             // 传给 hash_tile
+};
+
+struct ResultCacheStats
+{
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+    int64_t inserts = 0;
+    size_t size = 0;
+
+    double hit_rate() const { return hits + misses ? (double)hits / (hits + misses) : 0.0; }
+};
+
+// 以 tile 内容哈希为键的推理结果缓存. 分片 + CLOCK 淘汰, 可被多个线程同时使用
+class ResultCache
+{
+public:
+    explicit ResultCache(const ResultCacheParams &params = ResultCacheParams());
+
+    uint64_t key_of(const cv::Mat &tile) const { return hash_tile(tile, params_.ignore_low_bits); }
+    // 命中时 out 为缓存的结果, id 由调用方改写
+    bool lookup(uint64_t key, resnet_results &out);
+    void insert(uint64_t key, const resnet_results &value);
+    void clear();
+
+    ResultCacheStats stats() const;
+    const ResultCacheParams &params() const { return params_; }
+
+private:
+    struct Slot
+    {
+        uint64_t key = 0;
+        resnet_results value;
+        bool referenced = false;
+        bool used = false;
+    };
+    struct Shard
+    {
+        std::mutex mtx;
+        std::unordered_map<uint64_t, uint32_t> index;
+        std::vector<Slot> slots;
+        size_t hand = 0;
+        size_t used = 0;
+    };
+
+    Shard &shard_of(uint64_t key) { return *shards_[(key >> 32) % shards_.size()]; }
+
+    ResultCacheParams params_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<int64_t> hits_{0}, misses_{0}, evictions_{0}, inserts_{0};
+};
+
+// 包在 AutoParallelSimpleInferencePredictor 外面, 接口同 PredictAsync / PredictBatchAsync, 可直接交给
+// stream_predict 与 VideoPredictor. 命中时不进任何实例队列; 未命中时由推理线程在结果产出时写回缓存,
+// 不依赖调用方何时 get(). cache 的生命周期由调用方管理, 可跨帧 / 跨图复用
+template <typename AutoPredictor>
+class CachedPredictor
+{
+public:
+    CachedPredictor(AutoPredictor &predictor, ResultCache &cache) : predictor_(predictor), cache_(cache) {}
+
+    // on_result 与 AutoParallelSimpleInferencePredictor::PredictAsync 相同; 命中时在调用线程上立即回调
+    std::future<resnet_results> PredictAsync(const resnet_input &input,
+                                             std::function<void(resnet_results &)> on_result = nullptr)
+    {
+        uint64_t key = cache_.key_of(input.img);
+        resnet_results result;
+        if (cache_.lookup(key, result)) {
+            result.id = input.id;
+            if (on_result) {
+                on_result(result);
+            }
+            std::promise<resnet_results> promise;
+            promise.set_value(result);
+            return promise.get_future();
+        }
+
+        ResultCache &cache = cache_;
+        return predictor_.PredictAsync(input, [&cache, key, on_result](resnet_results &res) {
+            // 推理失败的 tile 不缓存, 下次再推
+            if (res.result[0].cls != ClassMap::NO_LABEL) {
+                cache.insert(key, res);
+            }
+            if (on_result) {
+                on_result(res);
+            }
+        });
+    }
+
+    // 命中的 tile 不进批次, 未命中的合成一批推理, 推理线程写回缓存后按原顺序拼回结果
+    std::future<std::vector<resnet_results>> PredictBatchAsync(std::vector<resnet_input> inputs)
+    {
+        auto hits = std::make_shared<std::vector<resnet_results>>(inputs.size());
+        auto keys = std::make_shared<std::vector<uint64_t>>();
+        auto slots = std::make_shared<std::vector<size_t>>();
+        std::vector<resnet_input> misses;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            uint64_t key = cache_.key_of(inputs[i].img);
+            if (cache_.lookup(key, (*hits)[i])) {
+                (*hits)[i].id = inputs[i].id;
+            } else {
+                keys->push_back(key);
+                slots->push_back(i);
+                misses.push_back(std::move(inputs[i]));
+            }
+        }
+        if (misses.empty()) {
+            std::promise<std::vector<resnet_results>> promise;
+            promise.set_value(std::move(*hits));
+            return promise.get_future();
+        }
+
+        ResultCache &cache = cache_;
+        return predictor_.PredictBatchAsync(std::move(misses),
+                                            [&cache, hits, keys, slots](std::vector<resnet_results> &results) {
+                                                for (size_t k = 0; k < results.size(); k++) {
+                                                    // 推理失败的 tile 不缓存, 下次再推
+                                                    if (results[k].result[0].cls != ClassMap::NO_LABEL) {
+                                                        cache.insert((*keys)[k], results[k]);
+                                                    }
+                                                    (*hits)[(*slots)[k]] = results[k];
+                                                }
+                                                results.swap(*hits);
+                                            });
+    }
+
+private:
+    AutoPredictor &predictor_;
+    ResultCache &cache_;
+};
@@ -3,18 +3,55 @@
 #include "rknn_api.h"
 #include "opencv2/core/core.hpp"
 #include "const.hpp"
+#include "preprocess.h"
+#include "tile_batch.hpp"
 #include <mutex>
 #include <string>
+#include <vector>
+
+// 构造参数, 可由模型路径隐式构造, 兼容原先直接传 std::string 的写法
+struct rkResnetParams
+{
+    std::string model_path;
+    bool enable_profile = false;   // 统计每次推理的前处理 / NPU / 后处理耗时
+    bool profile_layers = false;   // 以 RKNN_FLAG_COLLECT_PERF_MASK 初始化, 额外采集逐层耗时
+    // 输出为 int8 仿射量化时直接在整数域求第一名和 margin, 不把整个输出转成 float.
+    // 输出类型不符或 CLASS_NUM > 1 时自动退回 float 路径
+    bool int8_argmax = false;
+    bool int8_winner_prob = true;  // int8 路径下是否计算第一名的 softmax 概率, 关闭时 score 为 0
+
+    rkResnetParams(const std::string &model_path) : model_path(model_path) {}
+    rkResnetParams(const char *model_path) : model_path(model_path) {}
+};
+
+// 单个实例的累计耗时 (微秒), 仅在 enable_profile 时更新
+struct rkResnetStats
+{
+    int core_id = -1;
+    int64_t runs = 0;
+    int64_t preprocess_us = 0;    // cvtColor + resize + rknn_inputs_set
+    int64_t run_us = 0;           // rknn_run 墙钟时间, 含驱动开销
+    int64_t npu_us = 0;           // RKNN_QUERY_PERF_RUN 报告的 NPU 实际耗时
+    int64_t postprocess_us = 0;   // rknn_outputs_get + softmax + topk
+    std::string layer_detail;     // 最近一次推理的 RKNN_QUERY_PERF_DETAIL 文本
+
+    void merge(const rkResnetStats &other);
+};
+
+// 按 NPU 核心合并各实例的统计, 返回值下标为 core_id
+std::vector<rkResnetStats> merge_stats_by_core(const std::vector<rkResnetStats> &stats);
+void print_stats(const std::vector<rkResnetStats> &stats);
 
 class rkResnet
 {
 private:
     int ret;
     std::mutex mtx;
+    rkResnetParams params;
     std::string model_path;
     unsigned char *model_data = nullptr;
     rknn_context ctx = 0;
-    
+
     rknn_input_output_num io_num = {0};
     rknn_tensor_attr *input_attrs = nullptr;
     rknn_tensor_attr *output_attrs = nullptr;
@@ -23,14 +60,36 @@ private:
     int channel = 0, width = 0, height = 0;
     int img_width = 0, img_height = 0;
 
+    FusedPreprocessor preproc;
+    std::vector<uint8_t> input_buf;   // NHWC uint8, 每次推理复用
+
+    int num_classes = 0;
+    std::vector<float> logits_buf;    // [n, num_classes], PredictBatch 时按批扩容
+    bool quant_out = false;           // 输出保持 int8, 走 classify_batch_i8
+    float out_scale = 0.f;
+    float exp_table[256];
+    std::vector<int8_t> qlogits_buf;
+    std::vector<int> batch_ids, batch_slots;
+    std::vector<resnet_results> batch_results;
+    TileBatchPool batch_pool;         // PredictBatch 的打包缓冲, 批尺寸稳定后不再分配
+
+    rkResnetStats stats;
+
+    int infer(const cv::Mat& src, int slot);
+    void classify(int n, const int* ids, resnet_results* out);
+
 public:
     // 构造函数
-    rkResnet(const std::string &model_path);
+    rkResnet(const rkResnetParams &params);
     rkResnet(const rkResnet&) = delete;
     rkResnet& operator=(const rkResnet&) = delete;
 
     int init(rknn_context *ctx_in, bool isChild);
     rknn_context *get_pctx();
     resnet_results Predict(resnet_input& input);
+    // 整批先用 pack_tile_batch 打包成连续缓冲, 再逐个 tile 推理, 输出收集成 [n, classes] 后一次批量后处理.
+    // 空图或推理失败的 tile 保留自己的 id, cls 为 ClassMap::NO_LABEL
+    std::vector<resnet_results> PredictBatch(std::vector<resnet_input>& tiles);
+    rkResnetStats GetStats();
     ~rkResnet();
-};
\ No newline at end of file
+};
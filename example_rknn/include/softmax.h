@@ -0,0 +1,22 @@
+#ifndef _RKNN_DEMO_SOFTMAX_H_
+#define _RKNN_DEMO_SOFTMAX_H_
+
+// 分类头的 softmax 内核. exp 用 Cephes 多项式近似 (相对误差 < 2e-7, 输入截断到 [-87, 88.3], 结果不落入非规格化数),
+// NEON / AVX2 / SSE2 向量化, 其余平台走同一多项式的标量版本.
+// 每行只读一遍输入: 以 64 个元素为块求块内最大值, 立刻算 exp 并累加, 运行最大值变大时只对累加和
+// 做一次缩放, 已写出的 exp 值记在分段表里, 最后归一化时按段补乘.
+
+float fast_expf(float x);
+
+// in 与 out 可以相同 (原地), 按行连续存放 rows x cols
+void softmax_rows(const float *in, float *out, int rows, int cols);
+void log_softmax_rows(const float *in, float *out, int rows, int cols);
+
+// 只求每行最大的类别 (同值取下标小者) 和它的 softmax 概率 1 / sum(exp(x - max)), 不写出整行概率.
+// 不超过 16 列的窄行按组转置, 比较与求和沿批方向向量化
+void softmax_argmax_rows(const float *in, int rows, int cols, int *cls, float *score);
+
+// 原先的四趟 libm 实现, 作为精度基准
+void softmax_reference(float *array, int size);
+
+#endif //_RKNN_DEMO_SOFTMAX_H_
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "const.hpp"
+#include "tiling.hpp"
+
+// 逐行产出 BGR 像素的数据源, 例如按行带解码的 JPEG/PNG 解码器或相机行缓冲
+class RowSource
+{
+public:
+    virtual ~RowSource() = default;
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+    // 读取至多 max_rows 行 CV_8UC3 像素到 dst (行跨度 stride 字节), 返回实际行数, 0 表示结束
+    virtual int read_rows(uint8_t *dst, size_t stride, int max_rows) = 0;
+};
+
+// 把已解码的图像按行带吐出, 用于适配现有 cv::Mat 输入
+class MatRowSource : public RowSource
+{
+public:
+    explicit MatRowSource(const cv::Mat &image) : image_(image) {}
+    int width() const override { return image_.cols; }
+    int height() const override { return image_.rows; }
+    int read_rows(uint8_t *dst, size_t stride, int max_rows) override;
+
+private:
+    cv::Mat image_;
+    int next_row_ = 0;
+};
+
+// 读取无文件头的 BGR24 原始文件, 真正做到边读边切
+class RawRowSource : public RowSource
+{
+public:
+    RawRowSource(const std::string &path, int width, int height);
+    ~RawRowSource();
+    bool is_open() const { return fp_ != nullptr; }
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+    int read_rows(uint8_t *dst, size_t stride, int max_rows) override;
+
+private:
+    FILE *fp_ = nullptr;
+    int width_, height_;
+    int next_row_ = 0;
+};
+
+// 按 TilingSpec (默认 ROWS x COLS 网格) 把数据源切成 tile. 每凑齐一个 tile 行带就交出该行的
+// tile, id 与 split_image 一致为 i * cols + j. tile 是整帧缓冲上的 ROI, 可直接用于 synthesize_image.
+class StreamingTiler
+{
+public:
+    explicit StreamingTiler(RowSource &source, const TilingSpec &spec = TilingSpec());
+
+    // 读入下一个 tile 行带并把其中的 tile 追加到 out, 没有更多完整行带时返回 false
+    bool next_band(std::vector<resnet_input> &out);
+
+    const cv::Mat &frame() const { return frame_; }
+    const TileLayout &layout() const { return layout_; }
+    int bands_done() const { return band_; }
+
+private:
+    RowSource &source_;
+    cv::Mat frame_;
+    TileLayout layout_;
+    int rows_read_ = 0;
+    int band_ = 0;
+};
+
+// 边读边提交: 每个行带就绪后立刻 PredictAsync, 解码与推理重叠.
+// inputs / futures 按 tile id 顺序追加, 与 split_image + PredictAsync 的结果一一对应.
+// on_result 转交给 PredictAsync, 在推理线程上按完成顺序回调, 可用于统计首个结果的时延
+template <typename AutoPredictor, typename PredictorResult>
+int stream_predict(RowSource &source, AutoPredictor &predictor, std::vector<resnet_input> &inputs,
+                   std::vector<std::future<PredictorResult>> &futures, const TilingSpec &spec = TilingSpec(),
+                   std::function<void(PredictorResult &)> on_result = nullptr)
+{
+    StreamingTiler tiler(source, spec);
+    inputs.reserve(tiler.layout().count());
+    futures.reserve(tiler.layout().count());
+
+    size_t submitted = inputs.size();
+    while (tiler.next_band(inputs)) {
+        for (; submitted < inputs.size(); ++submitted) {
+            futures.push_back(predictor.PredictAsync(inputs[submitted], on_result));
+        }
+    }
+    return tiler.bands_done();
+}
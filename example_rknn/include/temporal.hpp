@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+#include <future>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "const.hpp"
+#include "tiling.hpp"
+#include "utils.hpp"
+#include "class_map.hpp"
+
+struct TemporalParams
+{
+    int downsample = 4;           // 缩略图每个采样点对应 downsample x downsample 像素块, 1~8
+    float mean_threshold = 4.f;   // 缩略图平均绝对差超过它视为变化
+    int peak_threshold = 32;      // 任一采样点绝对差超过它也视为变化, 防止小目标被平均掉
+    int refresh_interval = 50;    // 每个 tile 至少每隔这么多帧重推一次以限制漂移, 0 关闭
+};
+
+struct TemporalStats
+{
+    int64_t frames = 0;
+    int64_t tiles = 0;       // 累计 tile 数
+    int64_t submitted = 0;   // 实际送推理的 tile 数
+    int64_t changed = 0;     // 其中因内容变化
+    int64_t refreshed = 0;   // 其中因周期刷新 (含首帧)
+};
+
+// 每个 tile 保存上次送推理时的逐通道缩略图, 新帧的缩略图与之比较 SAD.
+// 参考只在 commit() 时更新, 缓慢的渐变累积到阈值后同样会触发重推.
+class TileChangeDetector
+{
+public:
+    explicit TileChangeDetector(const TemporalParams &params = TemporalParams());
+
+    void reset(int tiles);
+    // 计算 tile 的缩略图并与参考比较, 没有参考时返回 true
+    bool changed(int id, const cv::Mat &tile);
+    // 把最近一次 changed() 计算的缩略图设为该 tile 的参考, 可以在该 tile 下一次 changed() 之前任意时刻调用
+    void commit(int id);
+
+private:
+    TemporalParams params_;
+    std::vector<std::vector<uint8_t>> ref_, cur_;
+};
+
+// 视频模式: 逐帧调用 process(), 只重推变化的 tile, 其余 tile 沿用上一帧的 resnet_results.
+// 周期刷新按 (帧号 + tile id) 错开, 每帧只刷新 1 / refresh_interval 的 tile, NPU 负载不会出现尖峰.
+template <typename AutoPredictor>
+class VideoPredictor
+{
+public:
+    VideoPredictor(AutoPredictor &predictor, const TilingSpec &spec = TilingSpec(),
+                   const TemporalParams &params = TemporalParams())
+        : predictor_(predictor), spec_(spec), params_(params), detector_(params) {}
+
+    // 处理一帧, 返回按 tile id 排列的结果. 帧尺寸变化时整帧重推
+    const std::vector<resnet_results> &process(const cv::Mat &frame)
+    {
+        bool reset = frame.cols != layout_.img_w || frame.rows != layout_.img_h || force_;
+        if (reset) {
+            layout_ = spec_.resolve(frame.cols, frame.rows);
+            detector_.reset(layout_.count());
+            results_.assign(layout_.count(), resnet_results());
+            for (int i = 0; i < layout_.count(); i++) {
+                results_[i].id = i;
+                results_[i].result[0].cls = ClassMap::NO_LABEL;
+            }
+            force_ = false;
+        }
+        inputs_ = split_image(frame, layout_);
+
+        std::vector<std::future<resnet_results>> futures;
+        std::vector<int> ids;
+        for (const auto &input : inputs_) {
+            bool changed = detector_.changed(input.id, input.img);
+            bool refresh = reset || (params_.refresh_interval > 0 &&
+                                     (frame_index_ + input.id) % params_.refresh_interval == 0);
+            if (!changed && !refresh) {
+                continue;
+            }
+            futures.push_back(predictor_.PredictAsync(input));
+            ids.push_back(input.id);
+            stats_.refreshed += refresh;
+            stats_.changed += !refresh;
+        }
+
+        // 只有推理成功才更新结果和变化检测的参考; 失败 (异常或 NO_LABEL) 时保留上一帧的结果与 id,
+        // 参考不动, 下一帧该 tile 仍判为变化而重推
+        for (size_t i = 0; i < futures.size(); i++) {
+            try {
+                resnet_results result = futures[i].get();
+                if (result.result[0].cls == ClassMap::NO_LABEL) {
+                    continue;
+                }
+                result.id = ids[i];
+                results_[ids[i]] = result;
+                detector_.commit(ids[i]);
+            } catch (const std::exception &e) {
+            }
+        }
+
+        frame_index_++;
+        stats_.frames++;
+        stats_.tiles += inputs_.size();
+        stats_.submitted += futures.size();
+        return results_;
+    }
+
+    // 下一帧整帧重推, 例如场景切换后
+    void request_refresh() { force_ = true; }
+
+    const TileLayout &layout() const { return layout_; }
+    const std::vector<resnet_input> &inputs() const { return inputs_; }
+    const TemporalStats &stats() const { return stats_; }
+
+private:
+    AutoPredictor &predictor_;
+    TilingSpec spec_;
+    TemporalParams params_;
+    TileChangeDetector detector_;
+    TileLayout layout_;
+    std::vector<resnet_input> inputs_;
+    std::vector<resnet_results> results_;
+    TemporalStats stats_;
+    int64_t frame_index_ = 0;
+    bool force_ = false;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "const.hpp"
+
+// 连续的 [n, h, w, c] uint8 批数据, 由 TileBatchPool 复用
+struct TileBatch
+{
+    std::vector<uint8_t> data;
+    std::vector<int> ids;   // 每个槽位对应的 tile id
+    int n = 0, h = 0, w = 0, c = 0;
+
+    size_t tile_bytes() const { return (size_t)h * w * c; }
+    uint8_t *tile(int i) { return data.data() + i * tile_bytes(); }
+    const uint8_t *tile(int i) const { return data.data() + i * tile_bytes(); }
+};
+
+// 批缓冲池. acquire() 返回的句柄析构时自动归还, 池先于句柄销毁也是安全的.
+// 缓冲只增不减, 批尺寸稳定后 acquire / pack 都不再分配内存.
+class TileBatchPool
+{
+private:
+    struct State
+    {
+        std::mutex mtx;
+        std::vector<TileBatch *> free_list;
+        size_t max_cached = 0;
+        ~State();
+    };
+
+public:
+    struct Releaser
+    {
+        std::shared_ptr<State> state;
+        void operator()(TileBatch *batch) const;
+    };
+    using Handle = std::unique_ptr<TileBatch, Releaser>;
+
+    explicit TileBatchPool(size_t max_cached = 8);
+    TileBatchPool(const TileBatchPool&) = delete;
+    TileBatchPool& operator=(const TileBatchPool&) = delete;
+
+    Handle acquire();
+
+private:
+    std::shared_ptr<State> state_;
+};
+
+// 把 tiles[first, first + n) 打包进 batch, 返回实际打包的数量.
+// 按源图行扫描: 外层是 tile 内的行号, 内层依次遍历批内 tile, 同一网格行的 tile
+// 在父图中左右相邻, 每条源缓存行只被读取一次. 尺寸不足 tile_w x tile_h 的边缘 tile 补零.
+int pack_tile_batch(const std::vector<resnet_input> &tiles, size_t first, int n,
+                    int tile_w, int tile_h, TileBatch &batch);
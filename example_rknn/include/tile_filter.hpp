@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <future>
+#include <opencv2/opencv.hpp>
+#include "const.hpp"
+#include "class_map.hpp"
+
+// 单趟统计一个 BGR tile 各通道的均值和方差
+struct TileMoments
+{
+    float mean[3];
+    float var[3];
+    float max_stddev() const;
+};
+
+bool compute_tile_moments(const cv::Mat &tile, TileMoments &moments);
+
+// 默认关闭: 打开后纯色 tile 不再经过模型, 输出可能与逐块推理不同
+struct TileFilterParams
+{
+    bool enabled = false;
+    float max_stddev = 3.f;          // 三个通道的标准差都不超过它时视为纯色 tile
+    float min_white_mean = 200.f;    // 纯色且三个通道均值都不低于它时才算白色
+    int blank_class = CLEAR_WHITE;   // 白色纯色 tile 直接给出的类别
+    int other_class = ClassMap::NO_LABEL;   // 其余纯色 tile (黑色补边 / 阴影 / 水面) 与空 tile 的类别
+    float blank_score = 1.f;
+};
+
+// 跳过统计, 用于调节阈值. stddev_hist[i] 统计标准差落在 [i, i+1) 的 tile 数, 最后一格含更大的值
+struct TileFilterStats
+{
+    static const int HIST_BINS = 32;
+    int64_t checked = 0;
+    int64_t skipped = 0;
+    int64_t hist[HIST_BINS] = {0};
+};
+
+// 推理前的纯色 tile 过滤: 天空 / 水面 / 补边这类 tile 不进 NPU 队列, 白色的给出 blank_class, 其余给出 other_class.
+// 可以被多个线程同时调用.
+class TileFilter
+{
+public:
+    explicit TileFilter(const TileFilterParams &params = TileFilterParams());
+
+    // 是纯色或空 tile 时填好 result 并返回 true
+    bool classify(const resnet_input &input, resnet_results &result);
+
+    TileFilterStats stats() const;
+    void reset_stats();
+    const TileFilterParams &params() const { return params_; }
+
+private:
+    TileFilterParams params_;
+    std::atomic<int64_t> checked_{0};
+    std::atomic<int64_t> skipped_{0};
+    std::atomic<int64_t> hist_[TileFilterStats::HIST_BINS];
+};
+
+// 带过滤的 PredictAsync: 纯色 tile 直接返回已就绪的 future, 其余照常提交
+template <typename AutoPredictor>
+std::future<resnet_results> filtered_predict(TileFilter &filter, AutoPredictor &predictor, const resnet_input &input)
+{
+    resnet_results result;
+    if (filter.classify(input, result)) {
+        std::promise<resnet_results> promise;
+        promise.set_value(result);
+        return promise.get_future();
+    }
+    return predictor.PredictAsync(input);
+}
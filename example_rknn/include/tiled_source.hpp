@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <future>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "const.hpp"
+#include "tiling.hpp"
+#include "streaming_tiler.hpp"
+
+// 按矩形区域取像素的大图数据源, 不要求整图驻留内存.
+// 调用方按行从上到下推进, release_rows(y) 表示 y 以上的行不再需要, 数据源可以释放对应内存.
+class TiledSource
+{
+public:
+    virtual ~TiledSource() = default;
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+    // 取出 rect 内的 BGR 像素 (rect 已在图内), 返回的 Mat 在数据源销毁前有效
+    virtual cv::Mat read(const cv::Rect &rect) = 0;
+    // 提示接下来要读 [y0, y1) 行
+    virtual void prefetch_rows(int /*y0*/, int /*y1*/) {}
+    virtual void release_rows(int /*y*/) {}
+};
+
+// 内存映射的无文件头原始文件. Interleaved 为 BGR24, tile 直接是映射区上的 ROI, 不拷贝;
+// Planar 为三个整幅平面依次存放 (planar_rgb 为 true 时平面顺序为 R, G, B), tile 拷贝时交织为 BGR.
+// 已处理的行带用 madvise 归还给内核, 驻留内存只与在途行带数有关.
+class MappedRawSource : public TiledSource
+{
+public:
+    enum class Layout
+    {
+        Interleaved,
+        Planar
+    };
+
+    MappedRawSource(const std::string &path, int width, int height, Layout layout = Layout::Interleaved,
+                    bool planar_rgb = false);
+    ~MappedRawSource();
+    MappedRawSource(const MappedRawSource &) = delete;
+    MappedRawSource &operator=(const MappedRawSource &) = delete;
+
+    bool is_open() const { return data_ != nullptr; }
+    int width() const override { return width_; }
+    int height() const override { return height_; }
+    cv::Mat read(const cv::Rect &rect) override;
+    void prefetch_rows(int y0, int y1) override;
+    void release_rows(int y) override;
+
+private:
+    // 行 [y0, y1) 在各平面中对应的页对齐区间执行 madvise
+    void advise_rows(int y0, int y1, int advice);
+
+    uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+    int width_, height_;
+    Layout layout_;
+    bool planar_rgb_;
+    int released_ = 0;
+};
+
+// 把逐行解码的 RowSource 适配为 TiledSource, 只缓存尚未释放的行. tile 从缓存拷出, 不受后续滑动影响.
+// 读取的区域必须单调向下推进 (不早于已释放的行). 适合不能 mmap 的输入 (管道, 逐行解码器),
+// 驻留内存约为 在途行带数 x tile 高度 行.
+class BandBufferSource : public TiledSource
+{
+public:
+    explicit BandBufferSource(RowSource &source);
+
+    int width() const override { return source_.width(); }
+    int height() const override { return source_.height(); }
+    cv::Mat read(const cv::Rect &rect) override;
+    void release_rows(int y) override;
+    size_t buffered_rows() const { return rows_.size(); }
+    size_t peak_rows() const { return peak_rows_; }
+
+private:
+    bool fill_to(int y);
+
+    RowSource &source_;
+    std::deque<std::vector<uint8_t>> rows_;   // 第 i 个元素是图像第 first_row_ + i 行
+    int first_row_ = 0;
+    size_t peak_rows_ = 0;
+};
+
+// 取出布局中的 tile, 超出图像的部分 (Pad) 补零
+cv::Mat read_tile(TiledSource &source, const TileLayout &layout, int row, int col);
+
+// 逐行带提交大图的 tile, 至多 max_bands 个行带在途. 最早的行带全部完成后依次回调 on_result(result),
+// 并释放它独占的行, 结果按 tile id 顺序增量交出, 不经过整幅画布. 返回提交的行带数.
+template <typename AutoPredictor, typename OnResult>
+int stream_tiles(TiledSource &source, AutoPredictor &predictor, const TilingSpec &spec, OnResult &&on_result,
+                 int max_bands = 2)
+{
+    TileLayout layout = spec.resolve(source.width(), source.height());
+    std::deque<std::vector<std::future<resnet_results>>> bands;
+    int drained = 0;
+
+    auto drain = [&]() {
+        for (auto &future : bands.front()) {
+            try {
+                on_result(future.get());
+            } catch (const std::exception &e) {
+                // 单个 tile 失败不影响其余结果
+            }
+        }
+        bands.pop_front();
+        drained++;
+        source.release_rows(drained < layout.rows ? layout.ys[drained] : source.height());
+    };
+
+    for (int r = 0; r < layout.rows; r++) {
+        source.prefetch_rows(layout.ys[r], std::min(layout.ys[r] + layout.tile_h, source.height()));
+        std::vector<std::future<resnet_results>> band;
+        band.reserve(layout.cols);
+        for (int c = 0; c < layout.cols; c++) {
+            band.push_back(predictor.PredictAsync(resnet_input(read_tile(source, layout, r, c), layout.id(r, c))));
+        }
+        bands.push_back(std::move(band));
+        while ((int)bands.size() > std::max(max_bands, 1)) {
+            drain();
+        }
+    }
+    while (!bands.empty()) {
+        drain();
+    }
+    return layout.rows;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "const.hpp"
+
+// 图像边缘不足一个 tile 的余数如何处理
+enum class BorderPolicy
+{
+    Drop,    // 丢弃余数 (原 split_image 行为)
+    Shift,   // 末行/末列 tile 向内平移贴齐图像边缘, 与前一个 tile 部分重叠, 覆盖全部像素
+    Pad      // 末行/末列 tile 超出图像的部分补零, tile 需要拷贝
+};
+
+// 解析后的切分布局: 每行/每列 tile 左上角坐标, id = row * cols + col
+struct TileLayout
+{
+    int img_w = 0, img_h = 0;
+    int rows = 0, cols = 0;
+    int tile_w = 0, tile_h = 0;
+    std::vector<int> xs, ys;
+    BorderPolicy border = BorderPolicy::Drop;
+
+    int count() const { return rows * cols; }
+    int id(int row, int col) const { return row * cols + col; }
+    int row_of(int id) const { return id / cols; }
+    int col_of(int id) const { return id % cols; }
+    // 可能超出图像范围 (仅 Pad)
+    cv::Rect rect(int row, int col) const { return cv::Rect(xs[col], ys[row], tile_w, tile_h); }
+    bool uniform() const;   // 无重叠无补边的等分网格, 与 ROWS x COLS 的老布局相同
+};
+
+// 运行时切分参数. 两种模式:
+//   网格模式 (tile_w/tile_h 为 0): 按 rows x cols 等分, 默认值即 const.hpp 中的 ROWS x COLS
+//   尺寸模式 (tile_w/tile_h > 0): 固定 tile 尺寸和步长滑窗, 行列数由图像尺寸推出,
+//                                 stride 小于 tile 尺寸时相邻 tile 重叠
+struct TilingSpec
+{
+    int rows = ROWS, cols = COLS;
+    int tile_w = 0, tile_h = 0;
+    int stride_x = 0, stride_y = 0;   // 0 表示等于 tile 尺寸, 仅尺寸模式有效
+    BorderPolicy border = BorderPolicy::Drop;
+
+    static TilingSpec grid(int rows, int cols, BorderPolicy border = BorderPolicy::Drop);
+    static TilingSpec window(int tile_w, int tile_h, int stride_x = 0, int stride_y = 0,
+                             BorderPolicy border = BorderPolicy::Shift);
+
+    // 尺寸模式下图像比窗口还小时补零给出一个窗口, 此时 layout.border 为 Pad.
+    // 网格模式下图像宽 / 高小于 cols / rows 时每个 tile 不足 1 像素, 返回 0 个 tile (split_image 会报错),
+    // 不生成 1 像素的补零 tile. 图像为空或参数非正时同样是 0 个 tile
+    TileLayout resolve(int img_w, int img_h) const;
+};
+
+// 取出 (row, col) 处的 tile: 完全在图内时返回父图 ROI, 否则返回补零后的拷贝
+cv::Mat crop_tile(const cv::Mat &image, const TileLayout &layout, int row, int col);
@@ -0,0 +1,41 @@
+#ifndef _RKNN_DEMO_TOPK_H_
+#define _RKNN_DEMO_TOPK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "const.hpp"
+
+// 分类输出的 top-k 选择, 结果按分数从大到小排列, 分数相同时下标小的在前.
+//   k == 1:     向量化 argmax (NEON / AVX2 / SSE2)
+//   k <= 16:    长度为 k 的有序候选表, 大多数元素只与门槛比较一次
+//   其余:       nth_element 选出前 k 个后只对这 k 个排序
+// 不分配内存, 大 k 路径使用调用方提供的 scratch (至少 topk_scratch_size() 个元素).
+
+int argmax(const float *row, int cols);
+
+size_t topk_scratch_size(int cols, int k);
+
+// 返回实际输出个数 min(k, cols)
+int topk_row(const float *row, int cols, int k, element_t *out, element_t *scratch);
+
+// rows x cols 连续存放, out 每行 k 个
+void topk_rows(const float *in, int rows, int cols, int k, element_t *out, element_t *scratch);
+
+// int8 量化输出: scale > 0 时反量化 (q - zp) * scale 单调, 整数域的最大下标即 float / softmax 的最大下标.
+// top 为最大值, second 为去掉第一名之后的最大值 (并列第一时等于 top), cols <= 0 时 index 为 -1
+struct ArgmaxI8
+{
+    int index;
+    int8_t top;
+    int8_t second;
+};
+
+ArgmaxI8 argmax_i8(const int8_t *row, int cols);
+
+// table[d] = exp(-d * scale), d = 0..255
+void build_exp_table_i8(float scale, float table[256]);
+
+// 第一名的 softmax 概率 1 / sum_j exp((q_j - top) * scale), zp 在差值中抵消, 只查表不做反量化
+float winner_prob_i8(const int8_t *row, int cols, const ArgmaxI8 &best, const float table[256]);
+
+#endif //_RKNN_DEMO_TOPK_H_
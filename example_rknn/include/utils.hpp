@@ -5,6 +5,7 @@
 #include <opencv2/opencv.hpp>
 #include "rknn_api.h"
 #include "const.hpp"
+#include "tiling.hpp"
 #include <queue>
 #include <mutex>
 
@@ -13,6 +14,7 @@ unsigned char *load_data(FILE *fp, size_t ofst, size_t sz);
 unsigned char *load_model(const char *filename, int *model_size);
 int saveFloat(const char *file_name, float *output, int element_size);
 std::vector<resnet_input> split_image(cv::Mat& image);
+std::vector<resnet_input> split_image(const cv::Mat& image, const TileLayout& layout);
 
 
 std::vector<resnet_input> split_image_main(const std::string& image_path);
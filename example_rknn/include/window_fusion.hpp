@@ -0,0 +1,64 @@
+#pragma once
+
+#include <future>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "const.hpp"
+#include "tiling.hpp"
+#include "class_map.hpp"
+#include "utils.hpp"
+
+// 重叠滑窗的结果融合. 每个窗口用 top-1 类别给它覆盖到的输出格子投票, 权重为
+// 重叠面积 x 置信度 x 中心衰减 (窗口边缘的格子上下文不全, 权重降到中心的一半).
+// 窗口与格子的几何权重在构造时一次算好, add() 只做稀疏累加.
+class WindowFusion
+{
+public:
+    WindowFusion(const TileLayout &windows, const TileLayout &cells, int num_classes);
+
+    void reset();
+    void add(const resnet_results &result);
+    // 每个格子取得票最多的类别, 分数为该类得票占比; 没有窗口覆盖的格子为 NO_LABEL
+    ClassMap result() const;
+
+    int windows_added() const { return added_; }
+
+private:
+    struct Cover
+    {
+        int cell;
+        float weight;
+    };
+
+    TileLayout cells_;
+    int num_classes_;
+    std::vector<int> cover_begin_;   // 窗口 id -> cover_ 中的起始下标, 长度为窗口数 + 1
+    std::vector<Cover> cover_;
+    std::vector<float> votes_;       // [cell, class]
+    int added_ = 0;
+};
+
+// 单趟调度: 所有窗口一次性提交给并行预测器, 按提交顺序取回结果并融合到 cells 网格
+template <typename AutoPredictor>
+ClassMap predict_overlapping(AutoPredictor &predictor, const cv::Mat &image, const TilingSpec &window_spec,
+                             const TileLayout &cells, int num_classes)
+{
+    TileLayout windows = window_spec.resolve(image.cols, image.rows);
+    std::vector<resnet_input> inputs = split_image(image, windows);
+
+    std::vector<std::future<resnet_results>> futures;
+    futures.reserve(inputs.size());
+    for (const auto &input : inputs) {
+        futures.push_back(predictor.PredictAsync(input));
+    }
+
+    WindowFusion fusion(windows, cells, num_classes);
+    for (auto &future : futures) {
+        try {
+            fusion.add(future.get());
+        } catch (const std::exception &e) {
+            // 单个窗口失败不影响其余窗口的投票
+        }
+    }
+    return fusion.result();
+}
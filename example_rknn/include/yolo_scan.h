@@ -0,0 +1,18 @@
+#ifndef _RKNN_DEMO_YOLO_SCAN_H_
+#define _RKNN_DEMO_YOLO_SCAN_H_
+
+#include <stdint.h>
+
+// YOLO 输出头的 int8 候选扫描. 输出按通道平面存放 (channel-major), 同一通道相邻网格连续.
+//   scan_threshold_i8: 一次比较 16 (NEON / SSE2) 或 32 (AVX2) 个置信度字节, 输出紧凑的候选下标表
+//   argmax_planes_i8:  只对含候选的向量块在各类别平面上做 SIMD 最大值, 开销与候选数成正比
+
+// conf[0..n) 中 >= thres 的下标按升序写入 out (至少 n 个空间), 返回候选个数
+int scan_threshold_i8(const int8_t *conf, int n, int8_t thres, int32_t *out);
+
+// planes 个长度为 plane_len 的连续平面, 对每个候选 cells[i] (升序, < plane_len) 求各平面上的最大值
+// 和取到最大值的首个平面下标. planes 不超过 128
+void argmax_planes_i8(const int8_t *base, int plane_len, int planes, const int32_t *cells, int count,
+                      int8_t *max_val, uint8_t *max_id);
+
+#endif //_RKNN_DEMO_YOLO_SCAN_H_
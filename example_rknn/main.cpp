@@ -1,18 +1,354 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <string>
+#include <thread>
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include <sys/time.h>
+#include <dirent.h>
 #include <unistd.h>
 
 #include "rkResnet.hpp"
 #include "const.hpp"
 #include "utils.hpp"
 #include "postprocess.h"
+#include "streaming_tiler.hpp"
+#include "class_map.hpp"
+#include "window_fusion.hpp"
+#include "tile_filter.hpp"
+#include "result_cache.hpp"
+#include "temporal.hpp"
+#include "cascade.hpp"
+#include "tiled_source.hpp"
+#include "ingest.hpp"
+#include "ilogger.h"
 #include "src/parallel.h" 
+#include "src/trace.h"
 
 
-using AutoRKNN = AutoParallelSimpleInferencePredictor<rkResnet, const std::string &, resnet_input, resnet_results>;
+using AutoRKNN = AutoParallelSimpleInferencePredictor<rkResnet, rkResnetParams, resnet_input, resnet_results>;
+
+// 输出图只渲染这一类 (pingdi)
+const int OUTPUT_CLASS = 3;
+const int NUM_CLASSES = 5;
+
+static void print_cache_stats(const ResultCache* cache) {
+    if (cache != nullptr) {
+        ResultCacheStats cache_stats = cache->stats();
+        printf("Cache     : %lld hits / %lld misses / %lld evictions\n", (long long)cache_stats.hits,
+               (long long)cache_stats.misses, (long long)cache_stats.evictions);
+    }
+}
+
+// 流式模式: 每读完一个 tile 行带就提交推理, 读图与推理重叠
+// cache 非空时相同内容的 tile 直接复用结果
+static int run_streaming(const rkResnetParams& params, int thread_num, RowSource& source, const TilingSpec& spec,
+                         ResultCache* cache) {
+    std::cout << "Initializing AutoRKNN with " << thread_num << " threads..." << std::endl;
+    AutoRKNN predictor(params, thread_num);
+
+    auto start = std::chrono::steady_clock::now();
+    // 首个结果在推理线程上完成时记录, 不等整图提交完毕
+    std::atomic<int64_t> first_ns(-1);
+    std::function<void(resnet_results&)> on_result = [&first_ns, start](resnet_results&) {
+        int64_t expected = -1;
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        first_ns.compare_exchange_strong(expected, now);
+    };
+    std::vector<resnet_input> inputs;
+    std::vector<std::future<resnet_results>> futures;
+    if (cache != nullptr) {
+        CachedPredictor<AutoRKNN> cached(predictor, *cache);
+        stream_predict(source, cached, inputs, futures, spec, on_result);
+    } else {
+        stream_predict(source, predictor, inputs, futures, spec, on_result);
+    }
+    TileLayout layout = spec.resolve(source.width(), source.height());
+
+    std::vector<resnet_results> results_vec;
+    results_vec.reserve(futures.size());
+    for (size_t i = 0; i < futures.size(); ++i) {
+        try {
+            results_vec.push_back(futures[i].get());
+        } catch (const std::exception& e) {
+            resnet_results dummy;
+            dummy.id = inputs[i].id;
+            dummy.result[0].cls = ClassMap::NO_LABEL;
+            results_vec.push_back(dummy);
+        }
+    }
+    if (results_vec.empty()) {
+        std::cerr << "Error: stream produced no tiles." << std::endl;
+        return -1;
+    }
+    double first_ms = std::max<int64_t>(first_ns.load(), 0) / 1e6;
+
+    ClassMap class_map = ClassMap::from_results(results_vec, layout.rows, layout.cols);
+    double cost = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("--------------------------------\n");
+    printf("Mode      : Streaming\n");
+    printf("Processed : %zu blocks\n", results_vec.size());
+    print_cache_stats(cache);
+    printf("First Res : %.2f ms\n", first_ms);
+    printf("Total Time: %.2f ms\n", cost);
+    printf("--------------------------------\n");
+
+    if (params.enable_profile) {
+        print_stats(merge_stats_by_core(predictor.GetStats()));
+    }
+    cv::Mat output = class_map.render_class(inputs, OUTPUT_CLASS, layout);
+    if (!output.empty()) {
+        cv::imwrite("output_stream.jpg", output);
+    }
+    return 0;
+}
+
+// 重叠滑窗模式: 所有窗口一次提交, 投票融合到 spec 网格, 替代整帧平移后再跑一遍
+static int run_windows(const rkResnetParams& params, int thread_num, cv::Mat& image,
+                       const TilingSpec& window_spec, const TilingSpec& spec) {
+    std::cout << "Initializing AutoRKNN with " << thread_num << " threads..." << std::endl;
+    AutoRKNN predictor(params, thread_num);
+
+    auto start = std::chrono::steady_clock::now();
+    // 窗口贴边平移覆盖全部像素, 投票格子也不能丢弃边缘余数, 否则边缘仍然没有结果
+    TilingSpec cell_spec = spec;
+    if (cell_spec.border == BorderPolicy::Drop) {
+        cell_spec.border = BorderPolicy::Shift;
+    }
+    TileLayout cells = cell_spec.resolve(image.cols, image.rows);
+    TileLayout windows = window_spec.resolve(image.cols, image.rows);
+    ClassMap class_map = predict_overlapping(predictor, image, window_spec, cells, NUM_CLASSES);
+    double cost = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("--------------------------------\n");
+    printf("Mode      : Overlapping windows\n");
+    printf("Windows   : %d (%dx%d)\n", windows.count(), windows.rows, windows.cols);
+    printf("Cells     : %d (%dx%d)\n", cells.count(), cells.rows, cells.cols);
+    printf("Total Time: %.2f ms\n", cost);
+    printf("--------------------------------\n");
+
+    if (params.enable_profile) {
+        print_stats(merge_stats_by_core(predictor.GetStats()));
+    }
+    std::vector<resnet_input> inputs = split_image(image, cells);
+    cv::Mat output = class_map.render_class(inputs, OUTPUT_CLASS, cells);
+    if (!output.empty()) {
+        cv::imwrite("output_window.jpg", output);
+    }
+    return 0;
+}
+
+// 级联模式: 先推 4x7 粗网格, 只细分不确定或位于类别边界的粗格到 spec 网格
+static int run_cascade(const rkResnetParams& params, int thread_num, cv::Mat& image, const TilingSpec& spec) {
+    std::cout << "Initializing AutoRKNN with " << thread_num << " threads..." << std::endl;
+    AutoRKNN predictor(params, thread_num);
+
+    CascadeParams cascade;
+    cascade.levels = {TilingSpec::grid(4, 7), spec};
+    CascadeStats stats;
+    auto start = std::chrono::steady_clock::now();
+    ClassMap class_map = predict_cascade(predictor, image, cascade, &stats);
+    double cost = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    TileLayout cells = spec.resolve(image.cols, image.rows);
+    printf("--------------------------------\n");
+    printf("Mode      : Cascade\n");
+    for (size_t l = 0; l < stats.cells.size(); ++l) {
+        printf("Level %zu   : %d / %d blocks\n", l, stats.inferred[l], stats.cells[l]);
+    }
+    printf("Inferred  : %d (full grid %d)\n", stats.total_inferred(), cells.count());
+    printf("Total Time: %.2f ms\n", cost);
+    printf("--------------------------------\n");
+
+    if (params.enable_profile) {
+        print_stats(merge_stats_by_core(predictor.GetStats()));
+    }
+    std::vector<resnet_input> inputs = split_image(image, cells);
+    cv::Mat output = class_map.render_class(inputs, OUTPUT_CLASS, cells);
+    if (!output.empty()) {
+        cv::imwrite("output_cascade.jpg", output);
+    }
+    return 0;
+}
+
+// 大图模式: 内存映射原始文件按行带提交, 结果逐条写入 CSV, 只保留类别网格, 不生成全尺寸画布
+static int run_gigapixel(const rkResnetParams& params, int thread_num, TiledSource& source, const TilingSpec& spec) {
+    std::cout << "Initializing AutoRKNN with " << thread_num << " threads..." << std::endl;
+    AutoRKNN predictor(params, thread_num);
+
+    TileLayout layout = spec.resolve(source.width(), source.height());
+    ClassMap class_map(layout.rows, layout.cols);
+    FILE* csv = fopen("output_giga.csv", "w");
+    if (csv == nullptr) {
+        std::cerr << "Error: Open output_giga.csv failed." << std::endl;
+        return -1;
+    }
+    fprintf(csv, "id,row,col,cls,score\n");
+
+    auto start = std::chrono::steady_clock::now();
+    size_t done = 0;
+    stream_tiles(source, predictor, spec, [&](const resnet_results& res) {
+        class_map.set(res.id, res.result[0].cls, res.result[0].score);
+        fprintf(csv, "%d,%d,%d,%d,%.4f\n", res.id, layout.row_of(res.id), layout.col_of(res.id),
+                res.result[0].cls, res.result[0].score);
+        done++;
+    });
+    fclose(csv);
+    double cost = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("--------------------------------\n");
+    printf("Mode      : Gigapixel\n");
+    printf("Image     : %dx%d\n", source.width(), source.height());
+    printf("Processed : %zu / %d blocks\n", done, layout.count());
+    printf("Total Time: %.2f ms\n", cost);
+    printf("--------------------------------\n");
+
+    if (params.enable_profile) {
+        print_stats(merge_stats_by_core(predictor.GetStats()));
+    }
+    cv::imwrite("output_giga_labels.png", class_map.label_image());
+    return 0;
+}
+
+// 目录模式: 解码级在独立线程池上并发解码, 经定长队列按完成顺序交给切图与推理
+// cache 非空时跨图复用相同内容 tile 的结果
+static int run_directory(const rkResnetParams& params, int thread_num, const std::string& dir, const TilingSpec& spec,
+                         ResultCache* cache) {
+    std::vector<std::string> paths;
+    if (DIR* dp = opendir(dir.c_str())) {
+        while (struct dirent* entry = readdir(dp)) {
+            std::string name = entry->d_name;
+            size_t dot = name.rfind('.');
+            std::string ext = dot == std::string::npos ? "" : name.substr(dot + 1);
+            if (ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "bmp") {
+                paths.push_back(dir + "/" + name);
+            }
+        }
+        closedir(dp);
+    }
+    std::sort(paths.begin(), paths.end());
+    if (paths.empty()) {
+        std::cerr << "Error: No images in " << dir << std::endl;
+        return -1;
+    }
+
+    std::cout << "Initializing AutoRKNN with " << thread_num << " threads..." << std::endl;
+    AutoRKNN predictor(params, thread_num);
+    std::unique_ptr<CachedPredictor<AutoRKNN>> cached;
+    if (cache != nullptr) {
+        cached.reset(new CachedPredictor<AutoRKNN>(predictor, *cache));
+    }
+    DecodeStage decoder;
+
+    auto start = std::chrono::steady_clock::now();
+    decoder.submit(paths);
+    DecodedFrame frame;
+    size_t blocks = 0;
+    while (decoder.next(frame)) {
+        if (frame.image.empty()) {
+            std::cerr << "Error: Load image failed: " << frame.path << std::endl;
+            continue;
+        }
+        TileLayout layout = spec.resolve(frame.image.cols, frame.image.rows);
+        std::vector<resnet_input> inputs = split_image(frame.image, layout);
+        // 每个网格行作为一批提交, 实例对整行只做一次 softmax + top-k
+        std::vector<std::future<std::vector<resnet_results>>> futures;
+        for (size_t first = 0; first < inputs.size(); first += layout.cols) {
+            size_t last = std::min(inputs.size(), first + layout.cols);
+            std::vector<resnet_input> batch(inputs.begin() + first, inputs.begin() + last);
+            futures.push_back(cached ? cached->PredictBatchAsync(std::move(batch))
+                                     : predictor.PredictBatchAsync(std::move(batch)));
+        }
+        ClassMap class_map(layout.rows, layout.cols);
+        for (auto& future : futures) {
+            try {
+                for (const resnet_results& res : future.get()) {
+                    class_map.set(res.id, res.result[0].cls, res.result[0].score);
+                }
+            } catch (const std::exception& e) {
+            }
+        }
+        blocks += inputs.size();
+        printf("[%d] %s: %d / %d blocks of class %d\n", frame.index, frame.path.c_str(), class_map.count(OUTPUT_CLASS),
+               layout.count(), OUTPUT_CLASS);
+    }
+    double cost = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("--------------------------------\n");
+    printf("Mode      : Directory\n");
+    printf("Images    : %zu\n", paths.size());
+    printf("Processed : %zu blocks\n", blocks);
+    print_cache_stats(cache);
+    printf("Total Time: %.2f ms\n", cost);
+    printf("--------------------------------\n");
+
+    if (params.enable_profile) {
+        print_stats(merge_stats_by_core(predictor.GetStats()));
+    }
+    return 0;
+}
+
+// 视频逐帧处理, VideoPredictor 可以直接包住预测器, 也可以包住 CachedPredictor
+template <typename Video>
+static int run_video_frames(const rkResnetParams& params, AutoRKNN& predictor, cv::VideoCapture& capture,
+                            Video& video, const ResultCache* cache) {
+    cv::Mat frame;
+    ClassMap class_map;
+    auto start = std::chrono::steady_clock::now();
+    while (capture.read(frame)) {
+        const std::vector<resnet_results>& results = video.process(frame);
+        class_map = ClassMap::from_results(results, video.layout().rows, video.layout().cols);
+    }
+    double cost = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const TemporalStats& stats = video.stats();
+    if (stats.frames == 0) {
+        std::cerr << "Error: video produced no frames." << std::endl;
+        return -1;
+    }
+    printf("--------------------------------\n");
+    printf("Mode      : Video\n");
+    printf("Frames    : %lld\n", (long long)stats.frames);
+    printf("Submitted : %lld / %lld blocks (%lld changed, %lld refresh)\n", (long long)stats.submitted,
+           (long long)stats.tiles, (long long)stats.changed, (long long)stats.refreshed);
+    print_cache_stats(cache);
+    printf("Frame Time: %.2f ms\n", cost / stats.frames);
+    printf("FPS       : %.2f\n", stats.frames * 1000.0 / cost);
+    printf("--------------------------------\n");
+
+    if (params.enable_profile) {
+        print_stats(merge_stats_by_core(predictor.GetStats()));
+    }
+    cv::Mat output = class_map.render_class(video.inputs(), OUTPUT_CLASS, video.layout());
+    if (!output.empty()) {
+        cv::imwrite("output_video.jpg", output);
+    }
+    return 0;
+}
+
+// 视频模式: 只重推相对上次推理有变化的 tile, 输出最后一帧的结果图
+// cache 非空时重推的 tile 先查内容缓存, 画面在几种状态间往复时可省掉推理
+static int run_video(const rkResnetParams& params, int thread_num, const std::string& path, const TilingSpec& spec,
+                     ResultCache* cache) {
+    cv::VideoCapture capture(path);
+    if (!capture.isOpened()) {
+        std::cerr << "Error: Open video failed." << std::endl;
+        return -1;
+    }
+    std::cout << "Initializing AutoRKNN with " << thread_num << " threads..." << std::endl;
+    AutoRKNN predictor(params, thread_num);
+    if (cache != nullptr) {
+        CachedPredictor<AutoRKNN> cached(predictor, *cache);
+        VideoPredictor<CachedPredictor<AutoRKNN>> video(cached, spec);
+        return run_video_frames(params, predictor, capture, video, cache);
+    }
+    VideoPredictor<AutoRKNN> video(predictor, spec);
+    return run_video_frames(params, predictor, capture, video, cache);
+}
 
 int main(int argc, char** argv) {
 
@@ -20,19 +356,243 @@ int main(int argc, char** argv) {
     std::string image_path = "/home/orangepi/parallel/example_rknn/picture/pingdi.jpg";
     int thread_num = 3; // NPU 通常 3 核并行效率最高
 
-    cv::Mat input_image = cv::imread(image_path);
+    // --profile: 统计 NPU 与前后处理耗时; --profile-layers: 额外输出逐层耗时
+    // --stream-raw <file> <width> <height>: 从 BGR24 原始文件边读边推理
+    // --grid <rows> <cols>: 运行时覆盖 const.hpp 中的 ROWS x COLS
+    // --window <size> <stride>: 重叠滑窗, 边缘全覆盖, 结果投票融合到上面的网格
+    // --filter / --blank-stddev <v>: 打开纯色 tile 过滤 (默认关闭) / 调整其标准差阈值
+    // --cache <capacity>: 流式 / 视频 / 目录模式下按 tile 内容缓存推理结果, 缓存在整个运行期间复用
+    // --video <file>: 逐帧处理视频, 只重推变化的 tile
+    // --cascade: 4x7 粗网格到上面网格的由粗到细级联
+    // --giga <file> <width> <height> [--planar-rgb]: 内存映射的 BGR24 (或 RGB 平面) 大图, 结果写 CSV
+    //   [--band-buffer]: 改为顺序读 BGR24 并只缓存在途行带, 用于不能 mmap 的输入 (管道等)
+    // --dir <directory>: 并发解码目录中的全部图像并逐张推理
+    // --int8-argmax [--no-prob]: int8 输出直接在整数域分类 / 且不计算第一名的概率
+    // --log-dir <directory> [--log-rotate <MB>] [--log-flush <ms>]: 日志落盘, 退出时打印日志 I/O 开销
+    // --trace <file.json>: 记录线程池 / 预测器 / RKNN 各阶段时间线, 退出时写成 Chrome trace (ui.perfetto.dev 打开)
+    rkResnetParams params(model_path);
+    TileFilterParams filter_params;
+    TilingSpec spec;
+    TilingSpec window_spec;
+    bool window_mode = false;
+    bool cascade_mode = false;
+    std::string stream_path;
+    int stream_w = 0, stream_h = 0;
+    size_t cache_capacity = 0;
+    std::string video_path;
+    std::string giga_path;
+    std::string dir_path;
+    int giga_w = 0, giga_h = 0;
+    bool planar_rgb = false;
+    bool band_buffer = false;
+    std::string log_dir;
+    std::string trace_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--profile") {
+            params.enable_profile = true;
+        } else if (arg == "--profile-layers") {
+            params.enable_profile = true;
+            params.profile_layers = true;
+        } else if (arg == "--stream-raw" && i + 3 < argc) {
+            stream_path = argv[++i];
+            stream_w = atoi(argv[++i]);
+            stream_h = atoi(argv[++i]);
+        } else if (arg == "--grid" && i + 2 < argc) {
+            spec.rows = atoi(argv[++i]);
+            spec.cols = atoi(argv[++i]);
+        } else if (arg == "--window" && i + 2 < argc) {
+            int size = atoi(argv[++i]);
+            int stride = atoi(argv[++i]);
+            window_spec = TilingSpec::window(size, size, stride, stride, BorderPolicy::Shift);
+            window_mode = true;
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cache_capacity = (size_t)atol(argv[++i]);
+        } else if (arg == "--video" && i + 1 < argc) {
+            video_path = argv[++i];
+        } else if (arg == "--giga" && i + 3 < argc) {
+            giga_path = argv[++i];
+            giga_w = atoi(argv[++i]);
+            giga_h = atoi(argv[++i]);
+        } else if (arg == "--dir" && i + 1 < argc) {
+            dir_path = argv[++i];
+        } else if (arg == "--planar-rgb") {
+            planar_rgb = true;
+        } else if (arg == "--band-buffer") {
+            band_buffer = true;
+        } else if (arg == "--cascade") {
+            cascade_mode = true;
+        } else if (arg == "--filter") {
+            filter_params.enabled = true;
+        } else if (arg == "--no-filter") {
+            filter_params.enabled = false;
+        } else if (arg == "--blank-stddev" && i + 1 < argc) {
+            filter_params.max_stddev = (float)atof(argv[++i]);
+        } else if (arg == "--int8-argmax") {
+            params.int8_argmax = true;
+        } else if (arg == "--no-prob") {
+            params.int8_winner_prob = false;
+        } else if (arg == "--log-dir" && i + 1 < argc) {
+            log_dir = argv[++i];
+        } else if (arg == "--log-rotate" && i + 1 < argc) {
+            iLogger::set_logger_rotation((size_t)atol(argv[++i]) << 20);
+        } else if (arg == "--log-flush" && i + 1 < argc) {
+            iLogger::set_logger_flush_interval(atoi(argv[++i]));
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        }
+    }
+
+    struct TraceDump
+    {
+        std::string path;
+        ~TraceDump()
+        {
+            if (path.empty()) return;
+            PaddlePool::trace::set_enabled(false);
+            if (PaddlePool::trace::dump(path)) {
+                printf("trace written to %s (%llu events dropped)\n", path.c_str(),
+                       (unsigned long long)PaddlePool::trace::dropped());
+            } else {
+                printf("Error: failed to write trace %s\n", path.c_str());
+            }
+        }
+    } trace_dump{trace_path};
+    if (!trace_path.empty()) {
+        PaddlePool::trace::set_thread_name("main");
+        PaddlePool::trace::set_enabled(true);
+    }
+
+    // 各模式从多处 return, 用局部对象在退出时刷完日志再统计
+    struct LogIOReport
+    {
+        bool enabled;
+        ~LogIOReport()
+        {
+            if (!enabled) return;
+            iLogger::destroy_logger();
+            iLogger::LoggerIOStats io = iLogger::logger_io_stats();
+            printf("log io: %llu lines, %.1f KB, %llu flushes, %llu syscalls, %llu files, %llu dropped, "
+                   "drain %.2f ms, write %.2f ms\n",
+                   (unsigned long long)io.lines, io.bytes / 1024.0, (unsigned long long)io.flushes,
+                   (unsigned long long)io.syscalls, (unsigned long long)io.files, (unsigned long long)io.dropped,
+                   io.drain_ms, io.io_ms);
+        }
+    } log_report{!log_dir.empty()};
+    if (!log_dir.empty()) {
+        iLogger::set_logger_save_directory(log_dir);
+    }
+
+    std::unique_ptr<ResultCache> cache;
+    if (cache_capacity > 0) {
+        ResultCacheParams cache_params;
+        cache_params.capacity = cache_capacity;
+        cache.reset(new ResultCache(cache_params));
+    }
+
+    if (!stream_path.empty()) {
+        RawRowSource source(stream_path, stream_w, stream_h);
+        if (!source.is_open()) {
+            return -1;
+        }
+        try {
+            return run_streaming(params, thread_num, source, spec, cache.get());
+        } catch (const std::exception& e) {
+            std::cerr << "CRASH Exception: " << e.what() << std::endl;
+            return -1;
+        }
+    }
+
+    if (!giga_path.empty() && band_buffer) {
+        if (planar_rgb) {
+            std::cerr << "Error: --band-buffer only reads interleaved BGR24." << std::endl;
+            return -1;
+        }
+        RawRowSource raw(giga_path, giga_w, giga_h);
+        if (!raw.is_open()) {
+            return -1;
+        }
+        BandBufferSource source(raw);
+        try {
+            int ret = run_gigapixel(params, thread_num, source, spec);
+            printf("Band rows : peak %zu / %d buffered\n", source.peak_rows(), giga_h);
+            return ret;
+        } catch (const std::exception& e) {
+            std::cerr << "CRASH Exception: " << e.what() << std::endl;
+            return -1;
+        }
+    }
+
+    if (!giga_path.empty()) {
+        MappedRawSource source(giga_path, giga_w, giga_h,
+                               planar_rgb ? MappedRawSource::Layout::Planar : MappedRawSource::Layout::Interleaved,
+                               planar_rgb);
+        if (!source.is_open()) {
+            return -1;
+        }
+        try {
+            return run_gigapixel(params, thread_num, source, spec);
+        } catch (const std::exception& e) {
+            std::cerr << "CRASH Exception: " << e.what() << std::endl;
+            return -1;
+        }
+    }
+
+    if (!dir_path.empty()) {
+        try {
+            return run_directory(params, thread_num, dir_path, spec, cache.get());
+        } catch (const std::exception& e) {
+            std::cerr << "CRASH Exception: " << e.what() << std::endl;
+            return -1;
+        }
+    }
+
+    if (!video_path.empty()) {
+        try {
+            return run_video(params, thread_num, video_path, spec, cache.get());
+        } catch (const std::exception& e) {
+            std::cerr << "CRASH Exception: " << e.what() << std::endl;
+            return -1;
+        }
+    }
+
+    // 大 JPEG 按重启间隔分带并行解码, 不支持时退回整图解码
+    cv::Mat input_image;
+    {
+        PaddlePool::ThreadPool decode_pool(std::max(std::thread::hardware_concurrency(), 1u));
+        input_image = read_image_parallel(image_path, decode_pool);
+    }
     if (input_image.empty()) {
         std::cerr << "Error: Load image failed." << std::endl;
         return -1;
     }
 
+    if (cascade_mode) {
+        try {
+            return run_cascade(params, thread_num, input_image, spec);
+        } catch (const std::exception& e) {
+            std::cerr << "CRASH Exception: " << e.what() << std::endl;
+            return -1;
+        }
+    }
+
+    if (window_mode) {
+        try {
+            return run_windows(params, thread_num, input_image, window_spec, spec);
+        } catch (const std::exception& e) {
+            std::cerr << "CRASH Exception: " << e.what() << std::endl;
+            return -1;
+        }
+    }
+
     // 计时
     struct timeval time;
     gettimeofday(&time, nullptr);
     
 
     try {
-        std::vector<resnet_input> inputs = split_image(input_image);
+        TileLayout layout = spec.resolve(input_image.cols, input_image.rows);
+        std::vector<resnet_input> inputs = split_image(input_image, layout);
         size_t task_count = inputs.size();
         std::cout << "Tasks: " << task_count << std::endl;
 
@@ -44,32 +604,41 @@ int main(int argc, char** argv) {
         }
 
         std::cout << "Initializing AutoRKNN with " << thread_num << " threads..." << std::endl;
-        AutoRKNN predictor(model_path, thread_num);
+        AutoRKNN predictor(params, thread_num);
         
         auto startTime = time.tv_sec * 1000 + time.tv_usec / 1000;
         std::cout << "Submitting tasks..." << std::endl;
-        for (const auto& input : inputs) {
-            predictor.PredictThread(input);
-        }
-
+        // 纯色 tile 直接出结果, 不进推理队列
+        TileFilter filter(filter_params);
         std::vector<resnet_results> results_vec;
         results_vec.reserve(task_count);
+        std::vector<int> pending_ids;
+        for (const auto& input : inputs) {
+            resnet_results res;
+            if (filter.classify(input, res)) {
+                results_vec.push_back(res);
+            } else {
+                predictor.PredictThread(input);
+                pending_ids.push_back(input.id);
+            }
+        }
 
         std::cout << "Waiting for results..." << std::endl;
-        for (size_t i = 0; i < task_count; ++i) {
+        for (size_t i = 0; i < pending_ids.size(); ++i) {
             resnet_results res;
         
             if (predictor.GetResult(res)) {
                 results_vec.push_back(res);
             } else {
                 resnet_results dummy;
-                dummy.id = inputs[i].id; 
+                dummy.id = pending_ids[i];
+                dummy.result[0].cls = ClassMap::NO_LABEL;
                 results_vec.push_back(dummy);
             }
         }
 
         // 6. 后处理与保存
-        auto outputs = synthesize_image(inputs, results_vec);
+        ClassMap class_map = ClassMap::from_results(results_vec, layout.rows, layout.cols);
 
         gettimeofday(&time, nullptr);
         auto endTime = time.tv_sec * 1000 + time.tv_usec / 1000;
@@ -78,12 +647,19 @@ int main(int argc, char** argv) {
         printf("--------------------------------\n");
         printf("Mode      : AutoParallel\n");
         printf("Processed : %zu blocks\n", task_count);
+        TileFilterStats filter_stats = filter.stats();
+        printf("Skipped   : %lld / %lld blocks (uniform)\n", (long long)filter_stats.skipped, (long long)filter_stats.checked);
         printf("Total Time: %.2f ms\n", cost);
         printf("FPS       : %.2f\n", 1000.0 / cost);
         printf("--------------------------------\n");
 
-        if (!outputs.empty()) {
-            cv::imwrite("output_auto.jpg", outputs.size() > 3 ? outputs[3] : outputs[0]);
+        if (params.enable_profile) {
+            print_stats(merge_stats_by_core(predictor.GetStats()));
+        }
+
+        cv::Mat output = class_map.render_class(inputs, OUTPUT_CLASS, layout);
+        if (!output.empty()) {
+            cv::imwrite("output_auto.jpg", output);
         }
 
     } catch (const std::exception& e) {
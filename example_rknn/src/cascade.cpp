@@ -0,0 +1,144 @@
+#include "cascade.hpp"
+#include <algorithm>
+
+int CascadeStats::total_inferred() const
+{
+    int total = 0;
+    for (int n : inferred) total += n;
+    return total;
+}
+
+CascadePlan::CascadePlan(int img_w, int img_h, const CascadeParams &params) : params_(params)
+{
+    for (const auto &spec : params_.levels) {
+        TileLayout layout = spec.resolve(img_w, img_h);
+        if (layout.count() > 0) {
+            layouts_.push_back(layout);
+        }
+    }
+    levels_.resize(layouts_.size());
+
+    for (size_t l = 0; l < layouts_.size(); l++) {
+        const TileLayout &layout = layouts_[l];
+        Level &level = levels_[l];
+        level.parent.assign(layout.count(), -1);
+        level.label.assign(layout.count(), ClassMap::NO_LABEL);
+        level.score.assign(layout.count(), 0.f);
+        level.refined.assign(layout.count(), 0);
+        if (l == 0) continue;
+
+        // 按中心点找父格, 父格坐标取最后一个起点不超过中心的行/列
+        const TileLayout &up = layouts_[l - 1];
+        for (int r = 0; r < layout.rows; r++) {
+            int cy = layout.ys[r] + layout.tile_h / 2;
+            int pr = (int)(std::upper_bound(up.ys.begin(), up.ys.end(), cy) - up.ys.begin()) - 1;
+            for (int c = 0; c < layout.cols; c++) {
+                int cx = layout.xs[c] + layout.tile_w / 2;
+                int pc = (int)(std::upper_bound(up.xs.begin(), up.xs.end(), cx) - up.xs.begin()) - 1;
+                level.parent[layout.id(r, c)] = up.id(std::max(pr, 0), std::max(pc, 0));
+            }
+        }
+
+        Level &parent = levels_[l - 1];
+        parent.child_begin.assign(up.count() + 1, 0);
+        for (int p : level.parent) parent.child_begin[p + 1]++;
+        for (int i = 0; i < up.count(); i++) parent.child_begin[i + 1] += parent.child_begin[i];
+        parent.children.resize(layout.count());
+        std::vector<int> fill(parent.child_begin.begin(), parent.child_begin.end() - 1);
+        for (int id = 0; id < layout.count(); id++) {
+            parent.children[fill[level.parent[id]]++] = id;
+        }
+    }
+}
+
+std::vector<std::pair<int, int>> CascadePlan::initial() const
+{
+    std::vector<std::pair<int, int>> cells;
+    if (layouts_.empty()) return cells;
+    for (int id = 0; id < layouts_[0].count(); id++) {
+        cells.emplace_back(0, id);
+    }
+    return cells;
+}
+
+int CascadePlan::effective_label(int level, int id, float *score) const
+{
+    while (level >= 0 && levels_[level].label[id] == ClassMap::NO_LABEL) {
+        id = levels_[level].parent[id];
+        level--;
+        if (id < 0) return ClassMap::NO_LABEL;
+    }
+    if (level < 0) return ClassMap::NO_LABEL;
+    if (score) *score = levels_[level].score[id];
+    return levels_[level].label[id];
+}
+
+void CascadePlan::refine(int level, int id, std::vector<std::pair<int, int>> &submit)
+{
+    Level &lv = levels_[level];
+    if (level + 1 >= levels() || lv.refined[id]) return;
+    lv.refined[id] = 1;
+    for (int k = lv.child_begin[id]; k < lv.child_begin[id + 1]; k++) {
+        submit.emplace_back(level + 1, lv.children[k]);
+    }
+}
+
+void CascadePlan::on_result(int level, int id, const resnet_results &result,
+                            std::vector<std::pair<int, int>> &submit)
+{
+    const TileLayout &layout = layouts_[level];
+    Level &lv = levels_[level];
+    if (id < 0 || id >= layout.count()) return;
+
+    lv.label[id] = (int16_t)result.result[0].cls;
+    lv.score[id] = result.result[0].score;
+    lv.inferred++;
+    if (level + 1 >= levels()) return;
+
+    if (lv.label[id] == ClassMap::NO_LABEL || lv.score[id] < params_.min_score) {
+        refine(level, id, submit);
+    }
+    if (!params_.refine_boundaries || lv.label[id] == ClassMap::NO_LABEL) return;
+
+    // 与已知类别的四邻域比较, 类别不同说明这里是边界, 两侧都细分
+    int row = layout.row_of(id), col = layout.col_of(id);
+    const int dr[4] = {-1, 1, 0, 0};
+    const int dc[4] = {0, 0, -1, 1};
+    for (int k = 0; k < 4; k++) {
+        int r = row + dr[k], c = col + dc[k];
+        if (r < 0 || r >= layout.rows || c < 0 || c >= layout.cols) continue;
+        int n = layout.id(r, c);
+        int other = effective_label(level, n);
+        if (other != ClassMap::NO_LABEL && other != lv.label[id]) {
+            refine(level, id, submit);
+            refine(level, n, submit);
+        }
+    }
+}
+
+ClassMap CascadePlan::result() const
+{
+    if (layouts_.empty()) return ClassMap(0, 0);
+
+    int last = levels() - 1;
+    const TileLayout &layout = layouts_[last];
+    ClassMap map(layout.rows, layout.cols);
+    for (int id = 0; id < layout.count(); id++) {
+        float score = 0.f;
+        int label = effective_label(last, id, &score);
+        if (label != ClassMap::NO_LABEL) {
+            map.set(id, label, score);
+        }
+    }
+    return map;
+}
+
+CascadeStats CascadePlan::stats() const
+{
+    CascadeStats stats;
+    for (int l = 0; l < levels(); l++) {
+        stats.cells.push_back(layouts_[l].count());
+        stats.inferred.push_back(levels_[l].inferred);
+    }
+    return stats;
+}
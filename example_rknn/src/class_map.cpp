@@ -0,0 +1,251 @@
+#include "class_map.hpp"
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+// BGR 调色板, 类别号超出时循环使用
+static const uint8_t PALETTE[][3] = {
+    {0, 0, 255}, {0, 255, 0}, {255, 0, 0}, {0, 255, 255},
+    {255, 0, 255}, {255, 255, 0}, {128, 128, 255}, {255, 128, 0},
+};
+static const int PALETTE_SIZE = sizeof(PALETTE) / sizeof(PALETTE[0]);
+
+ClassMap::ClassMap(int rows, int cols)
+    : rows_(rows), cols_(cols), labels_(rows * cols, NO_LABEL), scores_(rows * cols, 0.f)
+{
+}
+
+ClassMap ClassMap::from_results(const std::vector<resnet_results> &results, int rows, int cols)
+{
+    ClassMap map(rows, cols);
+    for (const auto &result : results) {
+        map.set(result.id, result.result[0].cls, result.result[0].score);
+    }
+    return map;
+}
+
+void ClassMap::set(int id, int cls, float score)
+{
+    if (id < 0 || id >= rows_ * cols_) {
+        std::cerr << "Block ID out of range: " << id << std::endl;
+        return;
+    }
+    labels_[id] = (int16_t)cls;
+    scores_[id] = score;
+}
+
+int ClassMap::count(int cls) const
+{
+    int n = 0;
+    for (auto label : labels_) {
+        n += label == cls;
+    }
+    return n;
+}
+
+cv::Mat ClassMap::label_image() const
+{
+    cv::Mat image(rows_, cols_, CV_8UC1);
+    for (int i = 0; i < rows_ * cols_; i++) {
+        image.data[i] = labels_[i] < 0 ? 255 : (uint8_t)labels_[i];
+    }
+    return image;
+}
+
+bool ClassMap::uniform_layout(const std::vector<resnet_input> &inputs, TileLayout &layout) const
+{
+    if (rows_ <= 0 || cols_ <= 0 || inputs.empty() || inputs[0].img.empty()) {
+        std::cerr << "Cannot infer tile size: class map is " << rows_ << "x" << cols_ << ", "
+                  << inputs.size() << " tiles, first tile " << (inputs.empty() || inputs[0].img.empty() ? "empty" : "ok")
+                  << std::endl;
+        return false;
+    }
+    layout = TilingSpec::grid(rows_, cols_).resolve(cols_ * inputs[0].img.cols, rows_ * inputs[0].img.rows);
+    return true;
+}
+
+cv::Mat ClassMap::render_class(const std::vector<resnet_input> &inputs, int cls) const
+{
+    TileLayout layout;
+    if (!uniform_layout(inputs, layout)) {
+        return cv::Mat();
+    }
+    return render_class(inputs, cls, layout);
+}
+
+cv::Mat ClassMap::render_class(const std::vector<resnet_input> &inputs, int cls, const TileLayout &layout) const
+{
+    if (layout.rows != rows_ || layout.cols != cols_) {
+        std::cerr << "Layout " << layout.rows << "x" << layout.cols << " does not match class map "
+                  << rows_ << "x" << cols_ << std::endl;
+        return cv::Mat();
+    }
+
+    cv::Mat canvas = cv::Mat::zeros(layout.img_h, layout.img_w, CV_8UC3);
+    cv::Rect bounds(0, 0, layout.img_w, layout.img_h);
+    for (const auto &input : inputs) {
+        if (input.id < 0 || input.id >= rows_ * cols_ || labels_[input.id] != cls) continue;
+        if (input.img.rows != layout.tile_h || input.img.cols != layout.tile_w) {
+            std::cerr << "Block ID " << input.id << " has mismatched size: ("
+                      << input.img.cols << "x" << input.img.rows << ")" << std::endl;
+            continue;
+        }
+        // Pad 布局的边缘 tile 可能越出画布, 只拷贝图内部分
+        cv::Rect rect = layout.rect(layout.row_of(input.id), layout.col_of(input.id));
+        cv::Rect inside = rect & bounds;
+        cv::Rect src(inside.x - rect.x, inside.y - rect.y, inside.width, inside.height);
+        input.img(src).copyTo(canvas(inside));
+    }
+    return canvas;
+}
+
+cv::Mat ClassMap::render_palette(const std::vector<resnet_input> &inputs) const
+{
+    TileLayout layout;
+    if (!uniform_layout(inputs, layout)) {
+        return cv::Mat();
+    }
+    return render_palette(layout);
+}
+
+cv::Mat ClassMap::render_palette(const TileLayout &layout) const
+{
+    if (layout.rows != rows_ || layout.cols != cols_) {
+        return cv::Mat();
+    }
+
+    cv::Mat canvas = cv::Mat::zeros(layout.img_h, layout.img_w, CV_8UC3);
+    cv::Rect bounds(0, 0, layout.img_w, layout.img_h);
+    for (int i = 0; i < rows_ * cols_; i++) {
+        if (labels_[i] < 0) continue;
+        const uint8_t *color = PALETTE[labels_[i] % PALETTE_SIZE];
+        cv::Rect roi = layout.rect(layout.row_of(i), layout.col_of(i)) & bounds;
+        canvas(roi).setTo(cv::Scalar(color[0], color[1], color[2]));
+    }
+    return canvas;
+}
+
+ClassCompositor::ClassCompositor(int threads)
+{
+    threads_ = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+    if (threads_ < 1) threads_ = 1;
+    if (threads_ > 1) {
+        pool_.reset(new PaddlePool::ThreadPool(threads_ - 1));
+    }
+    pending_.reserve(threads_);
+}
+
+bool ClassCompositor::render(const ClassMap &map, const std::vector<resnet_input> &inputs,
+                             const std::vector<int> &classes, std::vector<cv::Mat> &outputs)
+{
+    TileLayout layout;
+    if (!map.uniform_layout(inputs, layout)) {
+        return false;
+    }
+    return render(map, inputs, layout, classes, outputs);
+}
+
+bool ClassCompositor::render(const ClassMap &map, const std::vector<resnet_input> &inputs, const TileLayout &layout,
+                             const std::vector<int> &classes, std::vector<cv::Mat> &outputs)
+{
+    if (layout.rows != map.rows() || layout.cols != map.cols() || layout.count() == 0) {
+        std::cerr << "Layout " << layout.rows << "x" << layout.cols << " does not match class map "
+                  << map.rows() << "x" << map.cols() << std::endl;
+        return false;
+    }
+
+    const int n_tiles = layout.count();
+    tile_data_.assign(n_tiles, nullptr);
+    tile_step_.assign(n_tiles, 0);
+    for (const auto &input : inputs) {
+        if (input.id < 0 || input.id >= n_tiles) continue;
+        if (input.img.type() != CV_8UC3 || input.img.rows != layout.tile_h || input.img.cols != layout.tile_w) {
+            std::cerr << "Block ID " << input.id << " has mismatched size: ("
+                      << input.img.cols << "x" << input.img.rows << ")" << std::endl;
+            continue;
+        }
+        tile_data_[input.id] = input.img.data;
+        tile_step_[input.id] = input.img.step;
+    }
+
+    outputs.resize(classes.size());
+    for (auto &output : outputs) {
+        output.create(layout.img_h, layout.img_w, CV_8UC3);
+    }
+
+    // 按画布行分段, 各段互不重叠; 调用线程处理第一段, 其余段交给线程池
+    int chunks = std::max(1, std::min(threads_, layout.img_h));
+    int per_chunk = (layout.img_h + chunks - 1) / chunks;
+    pending_.clear();
+    for (int begin = per_chunk; begin < layout.img_h; begin += per_chunk) {
+        int end = std::min(begin + per_chunk, layout.img_h);
+        pending_.push_back(pool_->submit([this, &map, &layout, &classes, &outputs, begin, end]() {
+            render_band(map, layout, classes, outputs, begin, end);
+        }));
+    }
+    render_band(map, layout, classes, outputs, 0, std::min(per_chunk, layout.img_h));
+    for (auto &f : pending_) {
+        f.get();
+    }
+    return true;
+}
+
+void ClassCompositor::render_band(const ClassMap &map, const TileLayout &layout, const std::vector<int> &classes,
+                                  std::vector<cv::Mat> &outputs, int y_begin, int y_end) const
+{
+    const int16_t *labels = map.labels().data();
+    const size_t row_bytes = (size_t)layout.tile_w * 3;
+
+    if (layout.uniform()) {
+        // 等分网格: 每条目标行按列依次拷贝或清零, 右侧余数清零, 每个字节只写一次
+        const size_t grid_bytes = row_bytes * layout.cols;
+        const size_t tail_bytes = (size_t)layout.img_w * 3 - grid_bytes;
+        for (int y = y_begin; y < y_end; y++) {
+            int tr = y / layout.tile_h;
+            int ty = y - tr * layout.tile_h;
+            for (size_t k = 0; k < classes.size(); k++) {
+                uint8_t *d = outputs[k].ptr<uint8_t>(y);
+                if (tr >= layout.rows) {
+                    memset(d, 0, grid_bytes + tail_bytes);
+                    continue;
+                }
+                for (int tc = 0; tc < layout.cols; tc++, d += row_bytes) {
+                    int id = layout.id(tr, tc);
+                    const uint8_t *src = tile_data_[id];
+                    if (src != nullptr && labels[id] == classes[k]) {
+                        memcpy(d, src + ty * tile_step_[id], row_bytes);
+                    } else {
+                        memset(d, 0, row_bytes);
+                    }
+                }
+                memset(d, 0, tail_bytes);
+            }
+        }
+        return;
+    }
+
+    // Shift / Pad: 清零本段后按 id 顺序贴上与本段相交的 tile 部分
+    for (size_t k = 0; k < classes.size(); k++) {
+        for (int y = y_begin; y < y_end; y++) {
+            memset(outputs[k].ptr<uint8_t>(y), 0, (size_t)layout.img_w * 3);
+        }
+        for (int tr = 0; tr < layout.rows; tr++) {
+            int y0 = std::max(layout.ys[tr], y_begin);
+            int y1 = std::min(layout.ys[tr] + layout.tile_h, y_end);
+            if (y0 >= y1) continue;
+            for (int tc = 0; tc < layout.cols; tc++) {
+                int id = layout.id(tr, tc);
+                const uint8_t *src = tile_data_[id];
+                if (src == nullptr || labels[id] != classes[k]) continue;
+                int x0 = std::max(layout.xs[tc], 0);
+                int x1 = std::min(layout.xs[tc] + layout.tile_w, layout.img_w);
+                if (x0 >= x1) continue;
+                for (int y = y0; y < y1; y++) {
+                    memcpy(outputs[k].ptr<uint8_t>(y) + (size_t)x0 * 3,
+                           src + (size_t)(y - layout.ys[tr]) * tile_step_[id] + (size_t)(x0 - layout.xs[tc]) * 3,
+                           (size_t)(x1 - x0) * 3);
+                }
+            }
+        }
+    }
+}
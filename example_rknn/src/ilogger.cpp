@@ -10,6 +10,8 @@
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
 #include <sstream>
 #include <stack>
@@ -35,6 +37,9 @@
 #	include <sys/types.h>
 #	include <sys/stat.h>
 #	include <unistd.h>
+#	include <fcntl.h>
+#	include <errno.h>
+#	include <sys/uio.h>
 #   include <stdarg.h>
 #	define strtok_s  strtok_r
 #endif
@@ -355,77 +360,399 @@ namespace iLogger{
         return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count() / 1000.0;
     }
 
+    // 每个生产线程独占一个单生产者单消费者的字节环, 记录为 [LogRecord][消息正文], 按 8 字节对齐.
+    // 生产者只写 head_, 消费者 (刷新线程) 只写 tail_, 两边都不加锁; 放不下的记录直接丢弃并计数.
+    struct LogRecord{
+        uint32_t size;          // 含头部与对齐的总字节数, WRAP_MARK 表示跳到环首
+        uint8_t level;
+        uint8_t echoed;         // 生产者已同步输出到终端 (Error / Fatal)
+        uint16_t msg_len;       // 消息正文字节数; 正文后的对齐填充可能是旧记录的残留
+        int32_t line;
+        time_t time;
+        const char* file;       // __FILE__ 字面量, 静态存储, 可以只存指针
+    };
+    static const uint32_t WRAP_MARK = 0xFFFFFFFFu;
+
+    struct LogRing{
+        vector<char> data;
+        size_t mask = 0;
+        atomic<uint64_t> head_{0};
+        atomic<uint64_t> tail_{0};
+        atomic<uint64_t> dropped_{0};
+        atomic<bool> in_use_{true};
+        atomic<bool> writing_{false};   // 所属线程正在 push, close 等它写完再做最后一次 drain
+        LogRing* next = nullptr;
+
+        explicit LogRing(size_t capacity) : data(capacity), mask(capacity - 1) {}
+
+        bool push(LogLevel level, bool echoed, const char* file, int line, time_t t, const char* msg, size_t len){
+            size_t need = (sizeof(LogRecord) + len + 7) & ~size_t(7);
+            uint64_t head = head_.load(memory_order_relaxed);
+            uint64_t tail = tail_.load(memory_order_acquire);
+            size_t offset = head & mask;
+            size_t to_end = data.size() - offset;
+            size_t total = need <= to_end ? need : to_end + need;
+            if (need > data.size() || head - tail + total > data.size()) {
+                dropped_.fetch_add(1, memory_order_relaxed);
+                return false;
+            }
+            if (need > to_end) {
+                // 尾部放不下整条记录, 留一个跳转标记, 从环首开始写
+                *(uint32_t*)&data[offset] = WRAP_MARK;
+                head += to_end;
+                offset = 0;
+            }
+            LogRecord* rec = (LogRecord*)&data[offset];
+            rec->size = (uint32_t)need;
+            rec->level = (uint8_t)level;
+            rec->echoed = echoed;
+            rec->msg_len = (uint16_t)len;
+            rec->line = line;
+            rec->time = t;
+            rec->file = file;
+            memcpy(rec + 1, msg, len);
+            head_.store(head + need, memory_order_release);
+            return true;
+        }
+
+        // 消费者: 逐条取出当前已发布的记录
+        template<typename Func>
+        void drain(Func&& func){
+            uint64_t head = head_.load(memory_order_acquire);
+            uint64_t tail = tail_.load(memory_order_relaxed);
+            while (tail != head) {
+                size_t offset = tail & mask;
+                const LogRecord* rec = (const LogRecord*)&data[offset];
+                if (rec->size == WRAP_MARK) {
+                    tail += data.size() - offset;
+                    continue;
+                }
+                func(*rec, (const char*)(rec + 1));
+                tail += rec->size;
+            }
+            tail_.store(tail, memory_order_release);
+        }
+    };
+
+    // set_logger_ring_size 可能与正在新建环的生产者并发
+    static atomic<size_t> log_ring_capacity{64 * 1024};
+    static const size_t LOG_MESSAGE_MAX = 2048;
+    static const size_t LOG_CHUNK_SIZE = 64 * 1024;
+
+    static const char* level_color(LogLevel level){
+        switch (level){
+            case LogLevel::Fatal:
+            case LogLevel::Error: return "\033[31m";
+            case LogLevel::Warning: return "\033[33m";
+            case LogLevel::Info: return "\033[35m";
+            case LogLevel::Verbose: return "\033[34m";
+            default: return nullptr;
+        }
+    }
+
+    // [时间][级别][文件:行号]:消息, color 为真时级别带终端颜色 (仅 Linux)
+    static int format_log_line(char* buffer, size_t size, const LogRecord& rec, const char* msg, bool color){
+        tm t;
+#if defined(U_OS_LINUX)
+        localtime_r(&rec.time, &t);
+#else
+        localtime_s(&t, &rec.time);
+#endif
+        LogLevel level = (LogLevel)rec.level;
+        const char* name = strrchr(rec.file, '/');
+        name = name ? name + 1 : rec.file;
+        const char* c = nullptr;
+#if defined(U_OS_LINUX)
+        c = color ? level_color(level) : nullptr;
+#endif
+        size_t len = rec.msg_len;
+        int n = snprintf(buffer, size, "[%04d-%02d-%02d %02d:%02d:%02d][%s%s%s][%s:%d]:%.*s",
+            t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec,
+            c ? c : "", level_string(level), c ? "\033[0m" : "", name, rec.line, (int)len, msg);
+        return std::min<int>(n, (int)size - 1);
+    }
+
     static struct Logger{
-        mutex logger_lock_;
+        mutex logger_lock_;         // 只在消费侧 (刷新线程 / Fatal / close) 使用
         string logger_directory;
         LogLevel logger_level{LogLevel::Info};
-        vector<string> cache_, local_;
         shared_ptr<thread> flush_thread_;
+        condition_variable wake_;
         atomic<bool> keep_run_{false};
+        atomic<int> thread_state_{0};   // 0 未启动, 1 启动中 / 运行, 2 已关闭
         shared_ptr<FILE> handler;
-        bool logger_shutdown{false};
-
-        void write(const string& line) {
+        atomic<bool> logger_shutdown{false};
+        atomic<LogRing*> rings_{nullptr};
+        uint64_t reported_dropped_ = 0;
+
+        // 以下文件相关状态只在持有 logger_lock_ 时访问. 文件常驻打开, 日期变化或超过轮转大小时才切换
+        vector<vector<char>> chunks_;
+        size_t chunks_used_ = 0;
+        uint64_t pending_bytes_ = 0, pending_lines_ = 0;
+        string file_date_;
+        int file_index_ = 0;
+        uint64_t file_size_ = 0, preallocated_end_ = 0;
+        uint64_t rotate_bytes_ = 0;                    // 0 表示只按日期轮转
+        uint64_t preallocate_bytes_ = 4 * 1024 * 1024;
+        atomic<int> flush_interval_ms_{1000};
+        LoggerIOStats io_stats_;
+
+        // 当前线程的环. 首次调用时认领已退出线程留下的空闲环, 没有则新建并无锁地挂到链表头
+        LogRing* thread_ring(){
+            struct Holder{
+                LogRing* ring = nullptr;
+                ~Holder(){ if (ring) ring->in_use_.store(false, memory_order_release); }
+            };
+            static thread_local Holder holder;
+            if (holder.ring)
+                return holder.ring;
+
+            for (LogRing* r = rings_.load(memory_order_acquire); r; r = r->next) {
+                bool expected = false;
+                if (r->in_use_.compare_exchange_strong(expected, true)) {
+                    holder.ring = r;
+                    return r;
+                }
+            }
+            // 环在进程退出前不释放: 退出较晚的线程仍可能写入
+            LogRing* ring = new LogRing(log_ring_capacity.load(memory_order_relaxed));
+            ring->next = rings_.load(memory_order_relaxed);
+            // seq_cst: 与 close 中的 logger_shutdown / rings_ 构成全序, close 没遍历到的新环一定能看到关闭标志
+            while (!rings_.compare_exchange_weak(ring->next, ring));
+            holder.ring = ring;
+            return ring;
+        }
 
-            lock_guard<mutex> l(logger_lock_);
-            if(logger_shutdown) 
+        void ensure_flush_thread(){
+            // 先只读检查, 避免每条日志都在共享缓存行上做一次加锁的 RMW
+            if (thread_state_.load(memory_order_acquire) != 0)
                 return;
+            int expected = 0;
+            if (thread_state_.compare_exchange_strong(expected, 1)) {
+                keep_run_ = true;
+                flush_thread_.reset(new thread(std::bind(&Logger::flush_job, this)));
+            }
+        }
+
+        // 生产者: 不加锁, 不分配内存. 返回 false 表示已关闭或环满丢弃 (计入 dropped_).
+        // 先置本环的 writing_ 再检查关闭标志 (均为 seq_cst), close 要么让这里看到关闭, 要么等这次 push 完成
+        bool write(LogLevel level, bool echoed, const char* file, int line, time_t t, const char* msg, size_t len){
+            if (logger_shutdown.load(memory_order_acquire))
+                return false;
+            LogRing* ring = thread_ring();
+            ring->writing_.store(true);
+            bool ok = false;
+            if (!logger_shutdown.load()) {
+                ensure_flush_thread();
+                ok = ring->push(level, echoed, file, line, t, msg, len);
+            }
+            ring->writing_.store(false, memory_order_release);
+            return ok;
+        }
 
-            if (!keep_run_) {
+        uint64_t dropped() const{
+            uint64_t total = 0;
+            for (LogRing* r = rings_.load(memory_order_acquire); r; r = r->next)
+                total += r->dropped_.load(memory_order_relaxed);
+            return total;
+        }
 
-                if(flush_thread_) 
-                    return;
+        // 消费者: 取出所有环中的记录, 未回显的输出到终端, 需要落盘的追加到 chunks_. 调用方持有 logger_lock_
+        void drain(){
+            auto begin = chrono::steady_clock::now();
+            char buffer[LOG_MESSAGE_MAX + 128];
+            bool to_file = !logger_directory.empty();
+            bool printed = false;
+            for (LogRing* r = rings_.load(memory_order_acquire); r; r = r->next) {
+                r->drain([&](const LogRecord& rec, const char* msg){
+                    if (!rec.echoed) {
+                        format_log_line(buffer, sizeof(buffer), rec, msg, true);
+                        fprintf(stdout, "%s\n", buffer);
+                        printed = true;
+                    }
+                    if (to_file) {
+                        int n = format_log_line(buffer, sizeof(buffer), rec, msg, false);
+                        append_file_line(buffer, n);
+                    }
+                });
+            }
+            uint64_t drops = dropped();
+            if (drops != reported_dropped_) {
+                int n = snprintf(buffer, sizeof(buffer), "[logger] dropped %llu lines (ring full)",
+                                 (unsigned long long)(drops - reported_dropped_));
+                fprintf(stderr, "%s\n", buffer);
+                if (to_file)
+                    append_file_line(buffer, n);
+                reported_dropped_ = drops;
+            }
+            if (printed)
+                fflush(stdout);
+            io_stats_.drain_ms += chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+        }
 
-                cache_.reserve(1000);
-                keep_run_ = true;
-                flush_thread_.reset(new thread(std::bind(&Logger::flush_job, this)));
+        // 待写文件的行按块拼接, 块在刷新之间复用, 一次 writev 写出全部块
+        void append_file_line(const char* line, int n){
+            if (n <= 0) return;
+            if (chunks_used_ == 0 or chunks_[chunks_used_ - 1].size() + n + 1 > LOG_CHUNK_SIZE) {
+                if (chunks_used_ == chunks_.size()) {
+                    chunks_.emplace_back();
+                    chunks_.back().reserve(LOG_CHUNK_SIZE);
+                }
+                chunks_[chunks_used_++].clear();
             }
-            cache_.emplace_back(line);
+            vector<char>& chunk = chunks_[chunks_used_ - 1];
+            chunk.insert(chunk.end(), line, line + n);
+            chunk.push_back('\n');
+            pending_bytes_ += n + 1;
+            pending_lines_++;
         }
 
-        void flush() {
+        string log_file_path(const string& date, int index) const{
+            if (index == 0)
+                return format("%s%s.txt", logger_directory.c_str(), date.c_str());
+            return format("%s%s.%d.txt", logger_directory.c_str(), date.c_str(), index);
+        }
 
-            if (cache_.empty())
-                return;
+        // 截掉预分配但未写入的尾部后关闭
+        void close_file(){
+            if (!handler) return;
+#if defined(U_OS_LINUX)
+            if (preallocated_end_ > file_size_ and ftruncate(fileno(handler.get()), file_size_) != 0) {}
+#endif
+            handler.reset();
+            preallocated_end_ = 0;
+        }
 
-            {
-                std::lock_guard<mutex> l(logger_lock_);
-                std::swap(local_, cache_);
+        // 文件按日期命名, 设置了轮转大小时写满后依次切到 <date>.1.txt, <date>.2.txt ...
+        bool open_file(){
+            auto date = date_now();
+            if (handler and date == file_date_ and (rotate_bytes_ == 0 or file_size_ < rotate_bytes_))
+                return true;
+
+            if (!handler or date != file_date_) {
+                file_index_ = 0;
+                file_date_ = date;
+            }
+            else {
+                file_index_++;
             }
+            close_file();
+
+            for (;; file_index_++) {
+                handler.reset(fopen_mkdirs(log_file_path(file_date_, file_index_), "ab"), fclose);
+                io_stats_.files++;
+                if (!handler)
+                    return false;
 
-            if (!local_.empty() and !logger_directory.empty()) {
+                fseek(handler.get(), 0, SEEK_END);
+                file_size_ = (uint64_t)ftell(handler.get());
+                preallocated_end_ = file_size_;
+                if (rotate_bytes_ == 0 or file_size_ < rotate_bytes_)
+                    return true;
+                handler.reset();
+            }
+        }
 
-                auto now = date_now();
-                auto file = format("%s%s.txt", logger_directory.c_str(), now.c_str());
-                if (!exists(file)) {
-                    handler.reset(fopen_mkdirs(file, "wb"), fclose);
+#if defined(U_OS_LINUX)
+        // 一次 writev 写出若干块, 普通文件上一般一次写完, 短写时按剩余部分补写
+        void write_chunks(int fd, size_t begin, size_t end){
+            iovec iov[64];
+            int count = 0;
+            size_t bytes = 0;
+            for (size_t i = begin; i < end; ++i, ++count) {
+                iov[count].iov_base = chunks_[i].data();
+                iov[count].iov_len = chunks_[i].size();
+                bytes += chunks_[i].size();
+            }
+#if defined(FALLOC_FL_KEEP_SIZE)
+            // 按块预分配磁盘空间, 文件长度不变, 减少追加写时的块分配与碎片
+            if (preallocate_bytes_ > 0 and file_size_ + bytes > preallocated_end_) {
+                uint64_t length = std::max<uint64_t>(preallocate_bytes_, bytes);
+                if (fallocate(fd, FALLOC_FL_KEEP_SIZE, (off_t)file_size_, (off_t)length) == 0)
+                    preallocated_end_ = file_size_ + length;
+                else
+                    preallocate_bytes_ = 0;    // 文件系统不支持, 不再尝试
+                io_stats_.syscalls++;
+            }
+#endif
+            int first = 0;
+            while (bytes > 0) {
+                ssize_t n = writev(fd, iov + first, count - first);
+                io_stats_.syscalls++;
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    break;
                 }
-                else if (!handler) {
-                    handler.reset(fopen_mkdirs(file, "a+"), fclose);
+                bytes -= n;
+                file_size_ += n;
+                while (first < count and (size_t)n >= iov[first].iov_len) {
+                    n -= iov[first].iov_len;
+                    first++;
                 }
+                if (first < count) {
+                    iov[first].iov_base = (char*)iov[first].iov_base + n;
+                    iov[first].iov_len -= n;
+                }
+            }
+        }
+#endif
 
-                if (handler) {
-                    for (auto& line : local_)
-                        fprintf(handler.get(), "%s\n", line.c_str());
-                    fflush(handler.get());
-                    handler.reset();
+        // 调用方持有 logger_lock_
+        void flush() {
+
+            drain();
+            if (pending_bytes_ == 0)
+                return;
+
+            auto begin = chrono::steady_clock::now();
+            size_t next = 0;
+            while (next < chunks_used_ and open_file()) {
+                // 每组至多 64 块, 且不跨越轮转边界 (至少一块, 单个文件最多超出一块)
+                size_t end = next;
+                uint64_t bytes = 0;
+                while (end < chunks_used_ and end - next < 64) {
+                    if (end > next and rotate_bytes_ > 0 and file_size_ + bytes + chunks_[end].size() > rotate_bytes_)
+                        break;
+                    bytes += chunks_[end++].size();
                 }
+#if defined(U_OS_LINUX)
+                write_chunks(fileno(handler.get()), next, end);
+#else
+                for (size_t i = next; i < end; ++i) {
+                    fwrite(chunks_[i].data(), 1, chunks_[i].size(), handler.get());
+                    io_stats_.syscalls++;
+                }
+                fflush(handler.get());
+                file_size_ += bytes;
+#endif
+                next = end;
+            }
+            if (next == chunks_used_) {
+                io_stats_.lines += pending_lines_;
+                io_stats_.bytes += pending_bytes_;
+                io_stats_.flushes++;
             }
-            local_.clear();
+            io_stats_.io_ms += chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+            chunks_used_ = 0;
+            pending_bytes_ = 0;
+            pending_lines_ = 0;
         }
 
         void flush_job() {
 
-            auto tick_begin = timestamp_now();
-            std::vector<string> local;
+            // 终端输出每个 tick 取一次, 文件按 flush_interval_ms_ 写. close 时通过 wake_ 立即唤醒
+            unique_lock<mutex> l(logger_lock_);
+            auto last_flush = timestamp_now();
             while (keep_run_) {
 
-                if (timestamp_now() - tick_begin < 1000) {
-                    this_thread::sleep_for(std::chrono::milliseconds(100));
+                int interval = flush_interval_ms_.load(memory_order_relaxed);
+                wake_.wait_for(l, chrono::milliseconds(std::min(100, interval)), [this]{ return !keep_run_; });
+                if (keep_run_ and timestamp_now() - last_flush < interval) {
+                    drain();
                     continue;
                 }
 
-                tick_begin = timestamp_now();
+                last_flush = timestamp_now();
                 flush();
             }
             flush();
@@ -455,18 +782,26 @@ namespace iLogger{
         }
 
         void close(){
-            {
-                lock_guard<mutex> l(logger_lock_);
-                if (logger_shutdown) return;
-
-                logger_shutdown = true;
-            };
+            if (logger_shutdown.exchange(true)) return;
 
-            if (!keep_run_) return;
-            keep_run_ = false;
-            flush_thread_->join();
-            flush_thread_.reset();
-            handler.reset();
+            int state = thread_state_.exchange(2);
+            if (state == 1) {
+                {
+                    lock_guard<mutex> l(logger_lock_);
+                    keep_run_ = false;
+                }
+                wake_.notify_all();
+                flush_thread_->join();
+                flush_thread_.reset();
+            }
+            // 检查关闭标志之前已进入 write 的生产者可能还在 push, 等它们写完再做最后一次 drain
+            for (LogRing* r = rings_.load(); r; r = r->next) {
+                while (r->writing_.load(memory_order_acquire))
+                    this_thread::yield();
+            }
+            lock_guard<mutex> l(logger_lock_);
+            flush();
+            close_file();
         }
 
         virtual ~Logger(){
@@ -478,41 +813,48 @@ namespace iLogger{
         __g_logger.close();
     }
 
-    static void remove_color_text(char* buffer){
-        
-        //"\033[31m%s\033[0m"
-        char* p = buffer;
-        while(*p){
-
-            if(*p == 0x1B){
-                char np = *(p + 1);
-                if(np == '['){
-                    // has token
-                    char* t = p + 2;
-                    while(*t){
-                        if(*t == 'm'){
-                            t = t + 1;
-                            char* k = p;
-                            while(*t){
-                                *k++ = *t++;
-                            }
-                            *k = 0;
-                            break;
-                        }
-                        t++;
-                    }
-                }
-            }
-            p++;
-        }
-    }
-
     void set_logger_save_directory(const string& loggerDirectory){
         __g_logger.set_save_directory(loggerDirectory);
     }
 
+    void set_logger_ring_size(size_t bytes){
+        size_t capacity = 4096;
+        while (capacity < bytes)
+            capacity <<= 1;
+        log_ring_capacity.store(capacity, memory_order_relaxed);
+    }
+
+    uint64_t logger_dropped_count(){
+        return __g_logger.dropped();
+    }
+
+    void set_logger_flush_interval(int ms){
+        __g_logger.flush_interval_ms_ = std::max(1, ms);
+        __g_logger.wake_.notify_all();
+    }
+
+    void set_logger_rotation(size_t max_file_bytes, size_t preallocate_bytes){
+        lock_guard<mutex> l(__g_logger.logger_lock_);
+        __g_logger.rotate_bytes_ = max_file_bytes;
+        __g_logger.preallocate_bytes_ = preallocate_bytes;
+    }
+
+    LoggerIOStats logger_io_stats(){
+        lock_guard<mutex> l(__g_logger.logger_lock_);
+        LoggerIOStats stats = __g_logger.io_stats_;
+        stats.dropped = __g_logger.dropped();
+        return stats;
+    }
+
+    std::atomic<int> __log_level{(int)LogLevel::Info};
+
+    long long __log_clock_ms(){
+        return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
     void set_log_level(LogLevel level){
         __g_logger.set_logger_level(level);
+        __log_level.store((int)level, memory_order_relaxed);
     }
 
     LogLevel get_log_level(){
@@ -524,67 +866,41 @@ namespace iLogger{
         if(level > __g_logger.logger_level)
             return;
 
-        string now = time_now();
+        char message[LOG_MESSAGE_MAX];
         va_list vl;
         va_start(vl, fmt);
-        
-        char buffer[2048];
-        string filename = file_name(file, true);
-        int n = snprintf(buffer, sizeof(buffer), "[%s]", now.c_str());
-
-#if defined(U_OS_WINDOWS)
-        if (level == LogLevel::Fatal or level == LogLevel::Error) {
-            n += snprintf(buffer + n, sizeof(buffer) - n, "[%s]", level_string(level));
+        int len = vsnprintf(message, sizeof(message), fmt, vl);
+        va_end(vl);
+        len = std::max(0, std::min(len, (int)sizeof(message) - 1));
+
+        LogRecord rec;
+        rec.size = (uint32_t)(sizeof(LogRecord) + len);
+        rec.level = (uint8_t)level;
+        rec.echoed = 0;
+        rec.msg_len = (uint16_t)len;
+        rec.line = line;
+        rec.time = time(nullptr);
+        rec.file = file;
+
+        // Error / Fatal 罕见且需要立即可见, 仍同步写 stderr; 其余级别交给刷新线程输出
+        bool urgent = level == LogLevel::Fatal or level == LogLevel::Error;
+        // 环满时只计数丢弃, 不退化为同步输出; 关闭之后没有刷新线程, 直接同步输出
+        bool closed = __g_logger.logger_shutdown.load(memory_order_acquire);
+        if (!closed and !__g_logger.write(level, urgent, file, line, rec.time, message, len)) {
+            // write 途中开始关闭而被拒收的记录也同步输出, 不能丢
+            closed = __g_logger.logger_shutdown.load(memory_order_acquire);
         }
-        else if (level == LogLevel::Warning) {
-            n += snprintf(buffer + n, sizeof(buffer) - n, "[%s]", level_string(level));
-        }
-        else {
-            n += snprintf(buffer + n, sizeof(buffer) - n, "[%s]", level_string(level));
-        }
-#elif defined(U_OS_LINUX)
-        if (level == LogLevel::Fatal or level == LogLevel::Error) {
-            n += snprintf(buffer + n, sizeof(buffer) - n, "[\033[31m%s\033[0m]", level_string(level));
-        }
-        else if (level == LogLevel::Warning) {
-            n += snprintf(buffer + n, sizeof(buffer) - n, "[\033[33m%s\033[0m]", level_string(level));
-        }
-        else if (level == LogLevel::Info) {
-            n += snprintf(buffer + n, sizeof(buffer) - n, "[\033[35m%s\033[0m]", level_string(level));
-        }
-        else if (level == LogLevel::Verbose) {
-            n += snprintf(buffer + n, sizeof(buffer) - n, "[\033[34m%s\033[0m]", level_string(level));
-        }
-        else {
-            n += snprintf(buffer + n, sizeof(buffer) - n, "[%s]", level_string(level));
-        }
-#endif
-
-        n += snprintf(buffer + n, sizeof(buffer) - n, "[%s:%d]:", filename.c_str(), line);
-        vsnprintf(buffer + n, sizeof(buffer) - n, fmt, vl);
-
-        if (level == LogLevel::Fatal or level == LogLevel::Error) {
-            fprintf(stderr, "%s\n", buffer);
-        }
-        else if (level == LogLevel::Warning) {
-            fprintf(stdout, "%s\n", buffer);
-        }
-        else {
-            fprintf(stdout, "%s\n", buffer);
+        if (urgent or closed) {
+            char buffer[LOG_MESSAGE_MAX + 128];
+            format_log_line(buffer, sizeof(buffer), rec, message, true);
+            fprintf(urgent ? stderr : stdout, "%s\n", buffer);
         }
 
-        if(!__g_logger.logger_directory.empty()){
-    #ifdef U_OS_LINUX
-            // remove save color txt
-            remove_color_text(buffer);
-    #endif 
-            __g_logger.write(buffer);
-            if (level == LogLevel::Fatal) {
+        if (level == LogLevel::Fatal) {
+            {
+                lock_guard<mutex> l(__g_logger.logger_lock_);
                 __g_logger.flush();
             }
-        }
-
-        if (level == LogLevel::Fatal) {
             fflush(stdout);
             abort();
         }
@@ -0,0 +1,263 @@
+#include "ingest.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <future>
+#include <thread>
+
+static inline int read_be16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+// JPEG 头部解析结果. header 为 SOI 到 SOS 段 (含) 的全部字节, 各带共用, 只改写 SOF 中的高度
+struct JpegLayout
+{
+    std::vector<uint8_t> header;
+    size_t height_offset = 0;            // header 中 SOF 高度字段的位置
+    int width = 0, height = 0;
+    int mcu_w = 8, mcu_h = 8;
+    int restart_interval = 0;
+    std::vector<std::pair<size_t, size_t>> intervals;   // 各重启间隔熵编码数据在原码流中的 [begin, end)
+};
+
+static bool parse_jpeg(const std::vector<uint8_t> &data, JpegLayout &jpeg)
+{
+    size_t n = data.size();
+    if (n < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+
+    jpeg.header.assign(data.begin(), data.begin() + 2);
+    int components = 0, hmax = 1, vmax = 1;
+    bool have_sof = false;
+    size_t pos = 2;
+    size_t scan = 0;
+    while (scan == 0) {
+        while (pos + 1 < n && data[pos] == 0xFF && data[pos + 1] == 0xFF) pos++;
+        if (pos + 4 > n || data[pos] != 0xFF) return false;
+        int marker = data[pos + 1];
+        size_t len = read_be16(&data[pos + 2]);
+        if (len < 2 || pos + 2 + len > n) return false;
+        const uint8_t *seg = &data[pos + 4];
+
+        switch (marker) {
+        case 0xC0:
+        case 0xC1:
+            if (len < 8) return false;
+            jpeg.height_offset = jpeg.header.size() + 5;
+            jpeg.height = read_be16(seg + 1);
+            jpeg.width = read_be16(seg + 3);
+            components = seg[5];
+            if (len < 8 + 3 * (size_t)components) return false;
+            for (int i = 0; i < components; i++) {
+                hmax = std::max(hmax, seg[6 + 3 * i + 1] >> 4);
+                vmax = std::max(vmax, seg[6 + 3 * i + 1] & 15);
+            }
+            have_sof = true;
+            break;
+        case 0xDD:
+            if (len < 4) return false;
+            jpeg.restart_interval = read_be16(seg);
+            break;
+        case 0xE1:
+            if (len >= 6 && memcmp(seg, "Exif", 4) == 0) return false;
+            break;
+        case 0xDA:
+            // 只支持包含全部分量的单次扫描
+            if (!have_sof || len < 3 || seg[0] != components) return false;
+            scan = pos + 2 + len;
+            break;
+        case 0xD9:
+            return false;
+        default:
+            // 渐进 / 无损 / 算术编码等其它 SOF
+            if ((marker >= 0xC2 && marker <= 0xCF) && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+                return false;
+            }
+            break;
+        }
+        jpeg.header.insert(jpeg.header.end(), data.begin() + pos, data.begin() + pos + 2 + len);
+        pos += 2 + len;
+    }
+
+    if (jpeg.width <= 0 || jpeg.height <= 0 || jpeg.restart_interval <= 0) return false;
+    if (components > 1) {
+        jpeg.mcu_w = 8 * hmax;
+        jpeg.mcu_h = 8 * vmax;
+    }
+
+    // 按 RST0~RST7 切分熵编码数据, FF00 为填充, 遇到 EOI 结束
+    size_t begin = scan;
+    for (size_t i = scan; i + 1 < n; i++) {
+        if (data[i] != 0xFF) continue;
+        int next = data[i + 1];
+        if (next == 0x00 || next == 0xFF) continue;
+        if (next >= 0xD0 && next <= 0xD7) {
+            jpeg.intervals.emplace_back(begin, i);
+            begin = i + 2;
+            i++;
+            continue;
+        }
+        if (next != 0xD9) return false;   // 多次扫描或 DNL
+        jpeg.intervals.emplace_back(begin, i);
+        break;
+    }
+
+    long long mcus = (long long)((jpeg.width + jpeg.mcu_w - 1) / jpeg.mcu_w) * ((jpeg.height + jpeg.mcu_h - 1) / jpeg.mcu_h);
+    return (long long)jpeg.intervals.size() == (mcus + jpeg.restart_interval - 1) / jpeg.restart_interval;
+}
+
+// 拼出 MCU 行 [row0, row1) 的独立码流, RST 从 0 重新编号
+static std::vector<uint8_t> build_band(const std::vector<uint8_t> &data, const JpegLayout &jpeg, int row0, int row1)
+{
+    int mcus_per_row = (jpeg.width + jpeg.mcu_w - 1) / jpeg.mcu_w;
+    int first = (int)((long long)row0 * mcus_per_row / jpeg.restart_interval);
+    int last = std::min((int)(((long long)row1 * mcus_per_row + jpeg.restart_interval - 1) / jpeg.restart_interval),
+                        (int)jpeg.intervals.size());
+    int height = std::min(row1 * jpeg.mcu_h, jpeg.height) - row0 * jpeg.mcu_h;
+
+    std::vector<uint8_t> band(jpeg.header);
+    band[jpeg.height_offset] = (uint8_t)(height >> 8);
+    band[jpeg.height_offset + 1] = (uint8_t)(height & 0xFF);
+    for (int k = first; k < last; k++) {
+        band.insert(band.end(), data.begin() + jpeg.intervals[k].first, data.begin() + jpeg.intervals[k].second);
+        if (k + 1 < last) {
+            band.push_back(0xFF);
+            band.push_back((uint8_t)(0xD0 + ((k - first) & 7)));
+        }
+    }
+    band.push_back(0xFF);
+    band.push_back(0xD9);
+    return band;
+}
+
+cv::Mat decode_jpeg_bands(const std::vector<uint8_t> &data, PaddlePool::ThreadPool &pool, int bands)
+{
+    JpegLayout jpeg;
+    if (bands < 2 || !parse_jpeg(data, jpeg)) {
+        return cv::Mat();
+    }
+
+    // 带边界只能放在恰好是重启间隔起点的 MCU 行上
+    int mcus_per_row = (jpeg.width + jpeg.mcu_w - 1) / jpeg.mcu_w;
+    int mcu_rows = (jpeg.height + jpeg.mcu_h - 1) / jpeg.mcu_h;
+    std::vector<int> cuts = {0};
+    for (int k = 1; k < bands; k++) {
+        int row = (int)((long long)k * mcu_rows / bands);
+        while (row < mcu_rows && ((long long)row * mcus_per_row) % jpeg.restart_interval != 0) row++;
+        if (row > cuts.back() && row < mcu_rows) cuts.push_back(row);
+    }
+    cuts.push_back(mcu_rows);
+    if (cuts.size() < 3) {
+        return cv::Mat();
+    }
+
+    // 每带向上下各多解到相邻的对齐 MCU 行, 让色度上采样在带边界处也有真实的相邻行, 解完再裁掉
+    auto aligned = [&](int row) { return ((long long)row * mcus_per_row) % jpeg.restart_interval == 0; };
+    auto decode = [&data, &jpeg, &aligned, mcu_rows](int row0, int row1) {
+        int ext0 = row0, ext1 = row1;
+        if (ext0 > 0) {
+            do ext0--; while (!aligned(ext0));
+        }
+        if (ext1 < mcu_rows) {
+            do ext1++; while (ext1 < mcu_rows && !aligned(ext1));
+        }
+        cv::Mat part = cv::imdecode(build_band(data, jpeg, ext0, ext1), cv::IMREAD_COLOR);
+        int y0 = (row0 - ext0) * jpeg.mcu_h;
+        int h = std::min(row1 * jpeg.mcu_h, jpeg.height) - row0 * jpeg.mcu_h;
+        if (part.rows < y0 + h || part.cols != jpeg.width || part.type() != CV_8UC3) {
+            return cv::Mat();
+        }
+        return part(cv::Rect(0, y0, jpeg.width, h));
+    };
+    // decode 按引用捕获 data / jpeg 等局部变量, 任何一步抛异常都要先等所有已提交的带结束再向外抛,
+    // 否则栈展开后池线程还在读这些变量
+    std::vector<std::future<cv::Mat>> pending;
+    std::vector<cv::Mat> parts;
+    try {
+        for (size_t b = 1; b + 1 < cuts.size(); b++) {
+            pending.push_back(pool.submit(decode, cuts[b], cuts[b + 1]));
+        }
+        parts.push_back(decode(cuts[0], cuts[1]));
+        for (auto &future : pending) {
+            parts.push_back(future.get());
+        }
+    } catch (...) {
+        for (auto &future : pending) {
+            if (future.valid()) {
+                future.wait();
+            }
+        }
+        throw;
+    }
+
+    cv::Mat image(jpeg.height, jpeg.width, CV_8UC3);
+    for (size_t b = 0; b < parts.size(); b++) {
+        if (parts[b].empty()) {
+            return cv::Mat();
+        }
+        parts[b].copyTo(image(cv::Rect(0, cuts[b] * jpeg.mcu_h, jpeg.width, parts[b].rows)));
+    }
+    return image;
+}
+
+cv::Mat read_image_parallel(const std::string &path, PaddlePool::ThreadPool &pool, int bands)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        printf("Open file %s failed.\n", path.c_str());
+        return cv::Mat();
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[1 << 16];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        data.insert(data.end(), chunk, chunk + got);
+    }
+    fclose(fp);
+
+    if (bands <= 0) {
+        bands = std::max((int)std::thread::hardware_concurrency(), 1) + 1;
+    }
+    cv::Mat image = decode_jpeg_bands(data, pool, bands);
+    if (image.empty()) {
+        image = cv::imdecode(data, cv::IMREAD_COLOR);
+    }
+    return image;
+}
+
+DecodeStage::DecodeStage(int threads, size_t capacity) : queue_(capacity)
+{
+    if (threads <= 0) {
+        threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    }
+    pool_.reset(new PaddlePool::ThreadPool(threads));
+}
+
+DecodeStage::~DecodeStage()
+{
+    queue_.close();
+    pool_.reset();
+}
+
+void DecodeStage::submit(const std::vector<std::string> &paths)
+{
+    for (const auto &path : paths) {
+        int index = submitted_++;
+        pool_->submit([this, index, path]() {
+            DecodedFrame frame;
+            frame.index = index;
+            frame.path = path;
+            frame.image = cv::imread(path, cv::IMREAD_COLOR);
+            queue_.push(std::move(frame));
+        });
+    }
+}
+
+bool DecodeStage::next(DecodedFrame &out)
+{
+    if (delivered_ >= submitted_ || !queue_.pop(out)) {
+        return false;
+    }
+    delivered_++;
+    return true;
+}
@@ -0,0 +1,267 @@
+#include "nms.h"
+
+#include <math.h>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline float iou_scalar(float ax1, float ay1, float ax2, float ay2, float aa,
+                               float bx1, float by1, float bx2, float by2, float ba)
+{
+    float w = std::max(0.f, std::min(ax2, bx2) - std::max(ax1, bx1) + 1.f);
+    float h = std::max(0.f, std::min(ay2, by2) - std::max(ay1, by1) + 1.f);
+    float inter = w * h;
+    float u = aa + ba - inter;
+    return u <= 0.f ? 0.f : inter / u;
+}
+
+void iou_one_to_many(const float *x1, const float *y1, const float *x2, const float *y2, const float *area,
+                     int i, int begin, int end, float *iou)
+{
+    int j = begin;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    float32x4_t ax1 = vdupq_n_f32(x1[i]), ay1 = vdupq_n_f32(y1[i]);
+    float32x4_t ax2 = vdupq_n_f32(x2[i]), ay2 = vdupq_n_f32(y2[i]);
+    float32x4_t aa = vdupq_n_f32(area[i]);
+    const float32x4_t one = vdupq_n_f32(1.f), zero = vdupq_n_f32(0.f);
+    for (; j + 4 <= end; j += 4)
+    {
+        float32x4_t w = vaddq_f32(vsubq_f32(vminq_f32(ax2, vld1q_f32(x2 + j)), vmaxq_f32(ax1, vld1q_f32(x1 + j))), one);
+        float32x4_t h = vaddq_f32(vsubq_f32(vminq_f32(ay2, vld1q_f32(y2 + j)), vmaxq_f32(ay1, vld1q_f32(y1 + j))), one);
+        float32x4_t inter = vmulq_f32(vmaxq_f32(w, zero), vmaxq_f32(h, zero));
+        float32x4_t u = vsubq_f32(vaddq_f32(aa, vld1q_f32(area + j)), inter);
+        uint32x4_t pos = vcgtq_f32(u, zero);
+        float32x4_t r = vdivq_f32(inter, vbslq_f32(pos, u, one));
+        vst1q_f32(iou + (j - begin), vbslq_f32(pos, r, zero));
+    }
+#elif defined(__AVX2__)
+    __m256 ax1 = _mm256_set1_ps(x1[i]), ay1 = _mm256_set1_ps(y1[i]);
+    __m256 ax2 = _mm256_set1_ps(x2[i]), ay2 = _mm256_set1_ps(y2[i]);
+    __m256 aa = _mm256_set1_ps(area[i]);
+    const __m256 one = _mm256_set1_ps(1.f), zero = _mm256_setzero_ps();
+    for (; j + 8 <= end; j += 8)
+    {
+        __m256 w = _mm256_add_ps(_mm256_sub_ps(_mm256_min_ps(ax2, _mm256_loadu_ps(x2 + j)),
+                                               _mm256_max_ps(ax1, _mm256_loadu_ps(x1 + j))), one);
+        __m256 h = _mm256_add_ps(_mm256_sub_ps(_mm256_min_ps(ay2, _mm256_loadu_ps(y2 + j)),
+                                               _mm256_max_ps(ay1, _mm256_loadu_ps(y1 + j))), one);
+        __m256 inter = _mm256_mul_ps(_mm256_max_ps(w, zero), _mm256_max_ps(h, zero));
+        __m256 u = _mm256_sub_ps(_mm256_add_ps(aa, _mm256_loadu_ps(area + j)), inter);
+        __m256 pos = _mm256_cmp_ps(u, zero, _CMP_GT_OQ);
+        __m256 r = _mm256_div_ps(inter, _mm256_blendv_ps(one, u, pos));
+        _mm256_storeu_ps(iou + (j - begin), _mm256_and_ps(pos, r));
+    }
+#elif defined(__SSE2__)
+    __m128 ax1 = _mm_set1_ps(x1[i]), ay1 = _mm_set1_ps(y1[i]);
+    __m128 ax2 = _mm_set1_ps(x2[i]), ay2 = _mm_set1_ps(y2[i]);
+    __m128 aa = _mm_set1_ps(area[i]);
+    const __m128 one = _mm_set1_ps(1.f), zero = _mm_setzero_ps();
+    for (; j + 4 <= end; j += 4)
+    {
+        __m128 w = _mm_add_ps(_mm_sub_ps(_mm_min_ps(ax2, _mm_loadu_ps(x2 + j)), _mm_max_ps(ax1, _mm_loadu_ps(x1 + j))), one);
+        __m128 h = _mm_add_ps(_mm_sub_ps(_mm_min_ps(ay2, _mm_loadu_ps(y2 + j)), _mm_max_ps(ay1, _mm_loadu_ps(y1 + j))), one);
+        __m128 inter = _mm_mul_ps(_mm_max_ps(w, zero), _mm_max_ps(h, zero));
+        __m128 u = _mm_sub_ps(_mm_add_ps(aa, _mm_loadu_ps(area + j)), inter);
+        __m128 pos = _mm_cmpgt_ps(u, zero);
+        __m128 r = _mm_div_ps(inter, _mm_or_ps(_mm_and_ps(pos, u), _mm_andnot_ps(pos, one)));
+        _mm_storeu_ps(iou + (j - begin), _mm_and_ps(pos, r));
+    }
+#endif
+    for (; j < end; j++)
+    {
+        iou[j - begin] = iou_scalar(x1[i], y1[i], x2[i], y2[i], area[i], x1[j], y1[j], x2[j], y2[j], area[j]);
+    }
+}
+
+NmsEngine::NmsEngine(const NmsParams &params) : params_(params)
+{
+}
+
+void NmsEngine::bucket(const float *boxes, const float *scores, const int *class_ids, int count)
+{
+    int buckets = 1;
+    if (!params_.class_agnostic)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            buckets = std::max(buckets, class_ids[i] + 1);
+        }
+    }
+
+    // 计数排序分桶, 桶内保持原下标升序; 负类别号的框直接忽略
+    offset_.assign(buckets + 1, 0);
+    for (int i = 0; i < count; i++)
+    {
+        int b = params_.class_agnostic ? 0 : class_ids[i];
+        if (b >= 0) offset_[b + 1]++;
+    }
+    for (int b = 0; b < buckets; b++)
+    {
+        offset_[b + 1] += offset_[b];
+    }
+    int total = offset_[buckets];
+    order_.resize(total);
+    cursor_.assign(offset_.begin(), offset_.end() - 1);
+    for (int i = 0; i < count; i++)
+    {
+        int b = params_.class_agnostic ? 0 : class_ids[i];
+        if (b >= 0) order_[cursor_[b]++] = i;
+    }
+
+    for (int b = 0; b < buckets; b++)
+    {
+        std::sort(order_.begin() + offset_[b], order_.begin() + offset_[b + 1], [scores](int a, int c) {
+            return scores[a] > scores[c] || (scores[a] == scores[c] && a < c);
+        });
+    }
+
+    score_.resize(total);
+    x1_.resize(total);
+    y1_.resize(total);
+    x2_.resize(total);
+    y2_.resize(total);
+    area_.resize(total);
+    for (int p = 0; p < total; p++)
+    {
+        const float *box = boxes + (size_t)order_[p] * 4;
+        score_[p] = scores[order_[p]];
+        x1_[p] = box[0];
+        y1_[p] = box[1];
+        x2_[p] = box[0] + box[2];
+        y2_[p] = box[1] + box[3];
+        area_[p] = (x2_[p] - x1_[p] + 1.f) * (y2_[p] - y1_[p] + 1.f);
+    }
+}
+
+int NmsEngine::run(const float *boxes, const float *scores, const int *class_ids, int count,
+                   std::vector<int> &keep, std::vector<float> &keep_scores)
+{
+    keep.clear();
+    keep_scores.clear();
+    if (count <= 0)
+    {
+        return 0;
+    }
+    bucket(boxes, scores, class_ids, count);
+    iou_.resize(order_.size());
+    return params_.mode == NmsMode::Matrix ? run_matrix(keep, keep_scores) : run_hard(keep, keep_scores);
+}
+
+int NmsEngine::run_hard(std::vector<int> &keep, std::vector<float> &keep_scores)
+{
+    int buckets = (int)offset_.size() - 1;
+    int limit = params_.max_output > 0 ? params_.max_output : (int)order_.size();
+    removed_.assign(order_.size(), 0);
+
+    // 堆中是桶号, cursor_[b] 为该桶当前未被抑制的最高分位置; 同分时原下标小的优先
+    auto lower = [this](int a, int b) {
+        int pa = cursor_[a], pb = cursor_[b];
+        return score_[pa] < score_[pb] || (score_[pa] == score_[pb] && order_[pa] > order_[pb]);
+    };
+    heap_.clear();
+    for (int b = 0; b < buckets; b++)
+    {
+        cursor_[b] = offset_[b];
+        if (offset_[b] < offset_[b + 1]) heap_.push_back(b);
+    }
+    std::make_heap(heap_.begin(), heap_.end(), lower);
+
+    while (!heap_.empty() && (int)keep.size() < limit)
+    {
+        std::pop_heap(heap_.begin(), heap_.end(), lower);
+        int b = heap_.back();
+        heap_.pop_back();
+        int p = cursor_[b], end = offset_[b + 1];
+        keep.push_back(order_[p]);
+        keep_scores.push_back(score_[p]);
+
+        // 只和本桶中更低分的框比较, 每个框至多被确认一次
+        int n = end - p - 1;
+        if (n > 0)
+        {
+            iou_one_to_many(x1_.data(), y1_.data(), x2_.data(), y2_.data(), area_.data(), p, p + 1, end, iou_.data());
+            for (int k = 0; k < n; k++)
+            {
+                removed_[p + 1 + k] |= iou_[k] > params_.iou_threshold;
+            }
+        }
+        int next = p + 1;
+        while (next < end && removed_[next]) next++;
+        if (next < end)
+        {
+            cursor_[b] = next;
+            heap_.push_back(b);
+            std::push_heap(heap_.begin(), heap_.end(), lower);
+        }
+    }
+    return (int)keep.size();
+}
+
+int NmsEngine::run_matrix(std::vector<int> &keep, std::vector<float> &keep_scores)
+{
+    int buckets = (int)offset_.size() - 1;
+    int total = (int)order_.size();
+    decay_.assign(total, 1.f);
+    compensate_.assign(total, 0.f);
+    const float sigma = params_.matrix_sigma;
+
+    // 逐行处理上三角: 处理到第 i 行时, 它与所有更高分框的最大 IoU (compensate) 已经确定
+    for (int b = 0; b < buckets; b++)
+    {
+        int begin = offset_[b], end = offset_[b + 1];
+        for (int i = begin; i + 1 < end; i++)
+        {
+            iou_one_to_many(x1_.data(), y1_.data(), x2_.data(), y2_.data(), area_.data(), i, i + 1, end, iou_.data());
+            float comp = compensate_[i];
+            for (int j = i + 1; j < end; j++)
+            {
+                float iou = iou_[j - i - 1];
+                float d;
+                if (params_.matrix_gaussian)
+                {
+                    d = expf(-sigma * (iou * iou - comp * comp));
+                }
+                else
+                {
+                    d = (1.f - iou) / std::max(1.f - comp, 1e-6f);
+                }
+                decay_[j] = std::min(decay_[j], d);
+                compensate_[j] = std::max(compensate_[j], iou);
+            }
+        }
+    }
+
+    // 衰减后的分数可能改变先后顺序, 重新选出前 max_output 个
+    std::vector<int> &cand = cursor_;   // 分桶已完成, 复用为候选表
+    cand.clear();
+    for (int p = 0; p < total; p++)
+    {
+        score_[p] *= decay_[p];
+        if (score_[p] > 0.f && score_[p] >= params_.score_threshold) cand.push_back(p);
+    }
+    auto better = [this](int a, int c) {
+        return score_[a] > score_[c] || (score_[a] == score_[c] && order_[a] < order_[c]);
+    };
+    int n = (int)cand.size();
+    if (params_.max_output > 0 && params_.max_output < n)
+    {
+        std::partial_sort(cand.begin(), cand.begin() + params_.max_output, cand.end(), better);
+        n = params_.max_output;
+    }
+    else
+    {
+        std::sort(cand.begin(), cand.end(), better);
+    }
+    for (int k = 0; k < n; k++)
+    {
+        keep.push_back(order_[cand[k]]);
+        keep_scores.push_back(score_[cand[k]]);
+    }
+    return n;
+}
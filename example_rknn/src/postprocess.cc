@@ -13,6 +13,10 @@
 // limitations under the License.
 
 #include "postprocess.h"
+#include "class_map.hpp"
+#include "softmax.h"
+#include "topk.h"
+#include "yolo_scan.h"
 
 #include <math.h>
 #include <stdint.h>
@@ -21,11 +25,9 @@
 #include <string.h>
 #include <sys/time.h>
 
-#include <set>
+#include <algorithm>
+#include <mutex>
 #include <vector>
-#define LABEL_NALE_TXT_PATH "./model/coco_80_labels_list.txt"
-
-static char *labels[OBJ_CLASS_NUM];
 
 const int anchor0[6] = {10, 13, 16, 30, 33, 23};
 const int anchor1[6] = {30, 61, 62, 45, 59, 119};
@@ -36,30 +38,29 @@ inline static int clamp(float val, int min, int max) { return val > min ? (val <
 char *readLine(FILE *fp, char *buffer, int *len)
 {
   int ch;
-  int i = 0;
-  size_t buff_len = 0;
+  size_t i = 0;
+  size_t cap = 64;
 
-  buffer = (char *)malloc(buff_len + 1);
+  buffer = (char *)malloc(cap);
   if (!buffer)
     return NULL; // Out of memory
 
   while ((ch = fgetc(fp)) != '\n' && ch != EOF)
   {
-    buff_len++;
-    void *tmp = realloc(buffer, buff_len + 1);
-    if (tmp == NULL)
+    // 容量成倍增长, 不再逐字节 realloc
+    if (i + 1 >= cap)
     {
-      free(buffer);
-      return NULL; // Out of memory
+      cap *= 2;
+      void *tmp = realloc(buffer, cap);
+      if (tmp == NULL)
+      {
+        free(buffer);
+        return NULL; // Out of memory
+      }
+      buffer = (char *)tmp;
     }
-    buffer = (char *)tmp;
-
-    buffer[i] = (char)ch;
-    i++;
+    buffer[i++] = (char)ch;
   }
-  buffer[i] = '\0';
-
-  *len = buff_len;
 
   // Detect end
   if (ch == EOF && (i == 0 || ferror(fp)))
@@ -67,13 +68,19 @@ char *readLine(FILE *fp, char *buffer, int *len)
     free(buffer);
     return NULL;
   }
+
+  // CRLF 文件去掉行尾的 '\r'
+  if (i > 0 && buffer[i - 1] == '\r')
+    i--;
+  buffer[i] = '\0';
+  *len = (int)i;
   return buffer;
 }
 
 int readLines(const char *fileName, char *lines[], int max_line)
 {
   FILE *file = fopen(fileName, "r");
-  char *s;
+  char *s = NULL;
   int i = 0;
   int n = 0;
 
@@ -83,102 +90,49 @@ int readLines(const char *fileName, char *lines[], int max_line)
     return -1;
   }
 
-  while ((s = readLine(file, s, &n)) != NULL)
+  while (i < max_line && (s = readLine(file, s, &n)) != NULL)
   {
     lines[i++] = s;
-    if (i >= max_line)
-      break;
   }
   fclose(file);
   return i;
 }
 
-int loadLabelName(const char *locationFilename, char *label[])
+const char *LabelTable::name(int id) const
 {
-  printf("loadLabelName %s\n", locationFilename);
-  readLines(locationFilename, label, OBJ_CLASS_NUM);
-  return 0;
+  return id >= 0 && id < (int)names.size() ? names[id].c_str() : "";
 }
 
-static float CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0, float xmin1, float ymin1, float xmax1,
-                              float ymax1)
+std::shared_ptr<const LabelTable> LabelTable::load(const char *path)
 {
-  float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);
-  float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);
-  float i = w * h;
-  float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) + (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;
-  return u <= 0.f ? 0.f : (i / u);
-}
-
-static int nms(int validCount, std::vector<float> &outputLocations, std::vector<int> classIds, std::vector<int> &order,
-               int filterId, float threshold)
-{
-  for (int i = 0; i < validCount; ++i)
+  char *lines[OBJ_CLASS_NUM] = {nullptr};
+  int n = readLines(path, lines, OBJ_CLASS_NUM);
+  if (n < 0)
   {
-    if (order[i] == -1 || classIds[i] != filterId)
-    {
-      continue;
-    }
-    int n = order[i];
-    for (int j = i + 1; j < validCount; ++j)
-    {
-      int m = order[j];
-      if (m == -1 || classIds[i] != filterId)
-      {
-        continue;
-      }
-      float xmin0 = outputLocations[n * 4 + 0];
-      float ymin0 = outputLocations[n * 4 + 1];
-      float xmax0 = outputLocations[n * 4 + 0] + outputLocations[n * 4 + 2];
-      float ymax0 = outputLocations[n * 4 + 1] + outputLocations[n * 4 + 3];
-
-      float xmin1 = outputLocations[m * 4 + 0];
-      float ymin1 = outputLocations[m * 4 + 1];
-      float xmax1 = outputLocations[m * 4 + 0] + outputLocations[m * 4 + 2];
-      float ymax1 = outputLocations[m * 4 + 1] + outputLocations[m * 4 + 3];
-
-      float iou = CalculateOverlap(xmin0, ymin0, xmax0, ymax0, xmin1, ymin1, xmax1, ymax1);
-
-      if (iou > threshold)
-      {
-        order[j] = -1;
-      }
-    }
+    return nullptr;
   }
-  return 0;
+  auto table = std::make_shared<LabelTable>();
+  table->names.reserve(n);
+  for (int i = 0; i < n; i++)
+  {
+    table->names.emplace_back(lines[i]);
+    free(lines[i]);
+  }
+  return table;
 }
 
-static int quick_sort_indice_inverse(std::vector<float> &input, int left, int right, std::vector<int> &indices)
+// 默认标签表, 首次使用时加载; 已取得它的上下文各自持有引用, deinitPostProcess 只释放这里的一份
+static std::mutex default_labels_mtx;
+static std::shared_ptr<const LabelTable> default_labels;
+
+std::shared_ptr<const LabelTable> LabelTable::shared()
 {
-  float key;
-  int key_index;
-  int low = left;
-  int high = right;
-  if (left < right)
+  std::lock_guard<std::mutex> lock(default_labels_mtx);
+  if (!default_labels)
   {
-    key_index = indices[left];
-    key = input[left];
-    while (low < high)
-    {
-      while (low < high && input[high] <= key)
-      {
-        high--;
-      }
-      input[low] = input[high];
-      indices[low] = indices[high];
-      while (low < high && input[low] >= key)
-      {
-        low++;
-      }
-      input[high] = input[low];
-      indices[high] = indices[low];
-    }
-    input[low] = key;
-    indices[low] = key_index;
-    quick_sort_indice_inverse(input, left, low - 1, indices);
-    quick_sort_indice_inverse(input, low + 1, right, indices);
+    default_labels = load(LABEL_NALE_TXT_PATH);
   }
-  return low;
+  return default_labels;
 }
 
 static float sigmoid(float x) { return 1.0 / (1.0 + expf(-x)); }
@@ -201,107 +155,135 @@ static int8_t qnt_f32_to_affine(float f32, int32_t zp, float scale)
 static float deqnt_affine_to_f32(int8_t qnt, int32_t zp, float scale) { return ((float)qnt - (float)zp) * scale; }
 
 static int process(int8_t *input, int *anchor, int grid_h, int grid_w, int height, int width, int stride,
-                   std::vector<float> &boxes, std::vector<float> &objProbs, std::vector<int> &classId, float threshold,
-                   int32_t zp, float scale)
+                   DetectScratch &scratch, float threshold, int32_t zp, float scale)
 {
   int validCount = 0;
   int grid_len = grid_h * grid_w;
   int8_t thres_i8 = qnt_f32_to_affine(threshold, zp, scale);
+
+  std::vector<float> &boxes = scratch.boxes;
+  std::vector<float> &objProbs = scratch.probs;
+  std::vector<int> &classId = scratch.class_ids;
+  // 候选下标与其类别最大值, 按最大网格数复用
+  std::vector<int32_t> &cells = scratch.cells;
+  std::vector<int8_t> &maxProbs = scratch.max_probs;
+  std::vector<uint8_t> &maxIds = scratch.max_ids;
+  if ((int)cells.size() < grid_len)
+  {
+    cells.resize(grid_len);
+    maxProbs.resize(grid_len);
+    maxIds.resize(grid_len);
+  }
+
   for (int a = 0; a < 3; a++)
   {
-    for (int i = 0; i < grid_h; i++)
+    int8_t *anchor_ptr = input + (PROP_BOX_SIZE * a) * grid_len;
+    int count = scan_threshold_i8(anchor_ptr + 4 * grid_len, grid_len, thres_i8, cells.data());
+    if (count == 0)
+    {
+      continue;
+    }
+    argmax_planes_i8(anchor_ptr + 5 * grid_len, grid_len, OBJ_CLASS_NUM, cells.data(), count, maxProbs.data(),
+                     maxIds.data());
+
+    for (int c = 0; c < count; c++)
     {
-      for (int j = 0; j < grid_w; j++)
+      int8_t maxClassProbs = maxProbs[c];
+      if (maxClassProbs <= thres_i8)
       {
-        int8_t box_confidence = input[(PROP_BOX_SIZE * a + 4) * grid_len + i * grid_w + j];
-        if (box_confidence >= thres_i8)
-        {
-          int offset = (PROP_BOX_SIZE * a) * grid_len + i * grid_w + j;
-          int8_t *in_ptr = input + offset;
-          float box_x = (deqnt_affine_to_f32(*in_ptr, zp, scale)) * 2.0 - 0.5;
-          float box_y = (deqnt_affine_to_f32(in_ptr[grid_len], zp, scale)) * 2.0 - 0.5;
-          float box_w = (deqnt_affine_to_f32(in_ptr[2 * grid_len], zp, scale)) * 2.0;
-          float box_h = (deqnt_affine_to_f32(in_ptr[3 * grid_len], zp, scale)) * 2.0;
-          box_x = (box_x + j) * (float)stride;
-          box_y = (box_y + i) * (float)stride;
-          box_w = box_w * box_w * (float)anchor[a * 2];
-          box_h = box_h * box_h * (float)anchor[a * 2 + 1];
-          box_x -= (box_w / 2.0);
-          box_y -= (box_h / 2.0);
-
-          int8_t maxClassProbs = in_ptr[5 * grid_len];
-          int maxClassId = 0;
-          for (int k = 1; k < OBJ_CLASS_NUM; ++k)
-          {
-            int8_t prob = in_ptr[(5 + k) * grid_len];
-            if (prob > maxClassProbs)
-            {
-              maxClassId = k;
-              maxClassProbs = prob;
-            }
-          }
-          if (maxClassProbs > thres_i8)
-          {
-            objProbs.push_back((deqnt_affine_to_f32(maxClassProbs, zp, scale)) * (deqnt_affine_to_f32(box_confidence, zp, scale)));
-            classId.push_back(maxClassId);
-            validCount++;
-            boxes.push_back(box_x);
-            boxes.push_back(box_y);
-            boxes.push_back(box_w);
-            boxes.push_back(box_h);
-          }
-        }
+        continue;
       }
+      int cell = cells[c];
+      int i = cell / grid_w;
+      int j = cell % grid_w;
+      int8_t *in_ptr = anchor_ptr + cell;
+      int8_t box_confidence = in_ptr[4 * grid_len];
+      float box_x = (deqnt_affine_to_f32(*in_ptr, zp, scale)) * 2.0 - 0.5;
+      float box_y = (deqnt_affine_to_f32(in_ptr[grid_len], zp, scale)) * 2.0 - 0.5;
+      float box_w = (deqnt_affine_to_f32(in_ptr[2 * grid_len], zp, scale)) * 2.0;
+      float box_h = (deqnt_affine_to_f32(in_ptr[3 * grid_len], zp, scale)) * 2.0;
+      box_x = (box_x + j) * (float)stride;
+      box_y = (box_y + i) * (float)stride;
+      box_w = box_w * box_w * (float)anchor[a * 2];
+      box_h = box_h * box_h * (float)anchor[a * 2 + 1];
+      box_x -= (box_w / 2.0);
+      box_y -= (box_h / 2.0);
+
+      objProbs.push_back((deqnt_affine_to_f32(maxClassProbs, zp, scale)) * (deqnt_affine_to_f32(box_confidence, zp, scale)));
+      classId.push_back(maxIds[c]);
+      validCount++;
+      boxes.push_back(box_x);
+      boxes.push_back(box_y);
+      boxes.push_back(box_w);
+      boxes.push_back(box_h);
     }
   }
   return validCount;
 }
 
-int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w, float conf_threshold,
-                 float nms_threshold, BOX_RECT pads, float scale_w, float scale_h, std::vector<int32_t> &qnt_zps,
-                 std::vector<float> &qnt_scales, detect_result_group_t *group)
+PostProcessContext::PostProcessContext() {}
+
+PostProcessContext::PostProcessContext(std::shared_ptr<const LabelTable> labels) : labels_(std::move(labels)) {}
+
+int PostProcessContext::init(const char *label_path)
+{
+  labels_ = label_path ? LabelTable::load(label_path) : LabelTable::shared();
+  return labels_ ? 0 : -1;
+}
+
+void PostProcessContext::set_nms_params(const NmsParams &params)
+{
+  nms_params_ = params;
+  if (nms_params_.max_output <= 0 || nms_params_.max_output > OBJ_NUMB_MAX_SIZE)
+  {
+    nms_params_.max_output = OBJ_NUMB_MAX_SIZE;
+  }
+  engine_.set_params(nms_params_);
+}
+
+int PostProcessContext::run(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w,
+                            float conf_threshold, BOX_RECT pads, float scale_w, float scale_h,
+                            const std::vector<int32_t> &qnt_zps, const std::vector<float> &qnt_scales,
+                            detect_result_group_t *group)
 {
-  static int init = -1;
-  if (init == -1)
+  if (!labels_)
   {
-    int ret = 0;
-    ret = loadLabelName(LABEL_NALE_TXT_PATH, labels);
-    if (ret < 0)
+    labels_ = LabelTable::shared();
+    if (!labels_)
     {
       return -1;
     }
-
-    init = 0;
   }
   memset(group, 0, sizeof(detect_result_group_t));
 
-  std::vector<float> filterBoxes;
-  std::vector<float> objProbs;
-  std::vector<int> classId;
+  // 清空但保留容量, 稳定运行后不再分配
+  scratch_.boxes.clear();
+  scratch_.probs.clear();
+  scratch_.class_ids.clear();
 
   // stride 8
   int stride0 = 8;
   int grid_h0 = model_in_h / stride0;
   int grid_w0 = model_in_w / stride0;
   int validCount0 = 0;
-  validCount0 = process(input0, (int *)anchor0, grid_h0, grid_w0, model_in_h, model_in_w, stride0, filterBoxes, objProbs,
-                        classId, conf_threshold, qnt_zps[0], qnt_scales[0]);
+  validCount0 = process(input0, (int *)anchor0, grid_h0, grid_w0, model_in_h, model_in_w, stride0, scratch_,
+                        conf_threshold, qnt_zps[0], qnt_scales[0]);
 
   // stride 16
   int stride1 = 16;
   int grid_h1 = model_in_h / stride1;
   int grid_w1 = model_in_w / stride1;
   int validCount1 = 0;
-  validCount1 = process(input1, (int *)anchor1, grid_h1, grid_w1, model_in_h, model_in_w, stride1, filterBoxes, objProbs,
-                        classId, conf_threshold, qnt_zps[1], qnt_scales[1]);
+  validCount1 = process(input1, (int *)anchor1, grid_h1, grid_w1, model_in_h, model_in_w, stride1, scratch_,
+                        conf_threshold, qnt_zps[1], qnt_scales[1]);
 
   // stride 32
   int stride2 = 32;
   int grid_h2 = model_in_h / stride2;
   int grid_w2 = model_in_w / stride2;
   int validCount2 = 0;
-  validCount2 = process(input2, (int *)anchor2, grid_h2, grid_w2, model_in_h, model_in_w, stride2, filterBoxes, objProbs,
-                        classId, conf_threshold, qnt_zps[2], qnt_scales[2]);
+  validCount2 = process(input2, (int *)anchor2, grid_h2, grid_w2, model_in_h, model_in_w, stride2, scratch_,
+                        conf_threshold, qnt_zps[2], qnt_scales[2]);
 
   int validCount = validCount0 + validCount1 + validCount2;
   // no object detect
@@ -310,46 +292,34 @@ int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h,
     return 0;
   }
 
-  std::vector<int> indexArray;
-  for (int i = 0; i < validCount; ++i)
-  {
-    indexArray.push_back(i);
-  }
-
-  quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
-
-  std::set<int> class_set(std::begin(classId), std::end(classId));
-
-  for (auto c : class_set)
-  {
-    nms(validCount, filterBoxes, classId, indexArray, c, nms_threshold);
-  }
+  // 按类别分桶排序后抑制, 凑满 OBJ_NUMB_MAX_SIZE 个即停止
+  const std::vector<float> &filterBoxes = scratch_.boxes;
+  std::vector<int> &keep = scratch_.keep;
+  std::vector<float> &keepProbs = scratch_.keep_probs;
+  int keepCount = engine_.run(filterBoxes.data(), scratch_.probs.data(), scratch_.class_ids.data(), validCount, keep,
+                              keepProbs);
 
   int last_count = 0;
   group->count = 0;
   /* box valid detect target */
-  for (int i = 0; i < validCount; ++i)
+  for (int i = 0; i < keepCount; ++i)
   {
-    if (indexArray[i] == -1 || last_count >= OBJ_NUMB_MAX_SIZE)
-    {
-      continue;
-    }
-    int n = indexArray[i];
+    int n = keep[i];
 
     float x1 = filterBoxes[n * 4 + 0] - pads.left;
     float y1 = filterBoxes[n * 4 + 1] - pads.top;
     float x2 = x1 + filterBoxes[n * 4 + 2];
     float y2 = y1 + filterBoxes[n * 4 + 3];
-    int id = classId[n];
-    float obj_conf = objProbs[i];
+    int id = scratch_.class_ids[n];
+    float obj_conf = keepProbs[i];
 
     group->results[last_count].box.left = (int)(clamp(x1, 0, model_in_w) / scale_w);
     group->results[last_count].box.top = (int)(clamp(y1, 0, model_in_h) / scale_h);
     group->results[last_count].box.right = (int)(clamp(x2, 0, model_in_w) / scale_w);
     group->results[last_count].box.bottom = (int)(clamp(y2, 0, model_in_h) / scale_h);
     group->results[last_count].prop = obj_conf;
-    char *label = labels[id];
-    strncpy(group->results[last_count].name, label, OBJ_NAME_MAX_SIZE);
+    const char *label = labels_->name(id);
+    strncpy(group->results[last_count].name, label, OBJ_NAME_MAX_SIZE - 1);
 
     // printf("result %2d: (%4d, %4d, %4d, %4d), %s\n", i, group->results[last_count].box.left,
     // group->results[last_count].box.top,
@@ -361,16 +331,31 @@ int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h,
   return 0;
 }
 
+int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w, float conf_threshold,
+                 float nms_threshold, BOX_RECT pads, float scale_w, float scale_h, std::vector<int32_t> &qnt_zps,
+                 std::vector<float> &qnt_scales, detect_result_group_t *group)
+{
+  NmsParams nms_params;
+  nms_params.iou_threshold = nms_threshold;
+  return post_process(input0, input1, input2, model_in_h, model_in_w, conf_threshold, pads, scale_w, scale_h, qnt_zps,
+                      qnt_scales, group, nms_params);
+}
+
+int post_process(int8_t *input0, int8_t *input1, int8_t *input2, int model_in_h, int model_in_w, float conf_threshold,
+                 BOX_RECT pads, float scale_w, float scale_h, std::vector<int32_t> &qnt_zps,
+                 std::vector<float> &qnt_scales, detect_result_group_t *group, const NmsParams &nms_params)
+{
+  // 旧接口: 每个线程一个上下文, 可以从线程池中并发调用
+  static thread_local PostProcessContext ctx;
+  ctx.set_nms_params(nms_params);
+  return ctx.run(input0, input1, input2, model_in_h, model_in_w, conf_threshold, pads, scale_w, scale_h, qnt_zps,
+                 qnt_scales, group);
+}
+
 void deinitPostProcess()
 {
-  for (int i = 0; i < OBJ_CLASS_NUM; i++)
-  {
-    if (labels[i] != nullptr)
-    {
-      free(labels[i]);
-      labels[i] = nullptr;
-    }
-  }
+  std::lock_guard<std::mutex> lock(default_labels_mtx);
+  default_labels.reset();
 }
 
 static void swap(element_t* a, element_t* b) {
@@ -402,7 +387,21 @@ static void quick_sort(element_t arr[], int low, int high) {
   }
 }
 
-void get_topk_with_indices(float arr[], int size,  resnet_results& results) {
+// 部分选择实现见 topk.cc, 每个线程的 scratch 只在类别数变大时扩容
+void get_topk_with_indices(float arr[], int size, resnet_results& results) {
+  static thread_local std::vector<element_t> scratch;
+  scratch.resize(std::max(scratch.size(), topk_scratch_size(size, CLASS_NUM)));
+
+  element_t top[CLASS_NUM];
+  int n = topk_row(arr, size, CLASS_NUM, top, scratch.data());
+  for (int i = 0; i < CLASS_NUM; i++) {
+    results.result[i].score = i < n ? top[i].value : 0.f;
+    results.result[i].cls = i < n ? top[i].index : -1;
+  }
+}
+
+// 原先的 malloc + 全量快速排序版本, 作为基准
+void get_topk_reference(float arr[], int size, resnet_results& results) {
 
   // Create an array of elements, saving values ​​and index numbers
   element_t* elements = (element_t*)malloc(size * sizeof(element_t));
@@ -424,30 +423,63 @@ void get_topk_with_indices(float arr[], int size,  resnet_results& results) {
 }
 
 
+// 向量化单趟实现见 softmax.cc, 原四趟版本保留为 softmax_reference()
 void softmax(float* array, int size) {
-  // Find the maximum value in the array
-  float max_val = array[0];
-  for (int i = 1; i < size; i++) {
-      if (array[i] > max_val) {
-          max_val = array[i];
-      }
-  }
+  softmax_rows(array, array, 1, size);
+}
 
-  // Subtract the maximum value from each element to avoid overflow
-  for (int i = 0; i < size; i++) {
-      array[i] -= max_val;
+void classify_batch(const float* logits, int n, int classes, const int* ids, resnet_results* out) {
+  if (n <= 0 || classes <= 0) {
+    return;
   }
-
-  // Compute the exponentials and sum
-  float sum = 0.0;
-  for (int i = 0; i < size; i++) {
-      array[i] = expf(array[i]);
-      sum += array[i];
+#if CLASS_NUM == 1
+  // 只要第一名: 不写出概率矩阵, 最大值与归一化和沿批方向一起算
+  static thread_local std::vector<int> cls;
+  static thread_local std::vector<float> score;
+  cls.resize(std::max<size_t>(cls.size(), n));
+  score.resize(std::max<size_t>(score.size(), n));
+  softmax_argmax_rows(logits, n, classes, cls.data(), score.data());
+  for (int i = 0; i < n; i++) {
+    out[i].result[0].cls = cls[i];
+    out[i].result[0].score = score[i];
+    out[i].result[0].margin = 0.f;
+    out[i].id = ids ? ids[i] : i;
   }
+#else
+  static thread_local std::vector<float> probs;
+  static thread_local std::vector<element_t> top;
+  static thread_local std::vector<element_t> scratch;
+  int k = std::min(CLASS_NUM, classes);
+  probs.resize(std::max(probs.size(), (size_t)n * classes));
+  top.resize(std::max(top.size(), (size_t)n * k));
+  scratch.resize(std::max(scratch.size(), topk_scratch_size(classes, k)));
+  softmax_rows(logits, probs.data(), n, classes);
+  topk_rows(probs.data(), n, classes, k, top.data(), scratch.data());
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < CLASS_NUM; j++) {
+      out[i].result[j].score = j < k ? top[(size_t)i * k + j].value : 0.f;
+      out[i].result[j].cls = j < k ? top[(size_t)i * k + j].index : -1;
+      out[i].result[j].margin = 0.f;
+    }
+    out[i].id = ids ? ids[i] : i;
+  }
+#endif
+}
 
-  // Normalize the array by dividing each element by the sum
-  for (int i = 0; i < size; i++) {
-      array[i] /= sum;
+void classify_batch_i8(const int8_t* logits, int n, int classes, float scale, const float* exp_table, const int* ids,
+                       resnet_results* out) {
+  for (int i = 0; i < n; i++) {
+    const int8_t* row = logits + (size_t)i * classes;
+    ArgmaxI8 best = argmax_i8(row, classes);
+    out[i].result[0].cls = best.index;
+    out[i].result[0].margin = (best.top - best.second) * scale;
+    out[i].result[0].score = exp_table ? winner_prob_i8(row, classes, best, exp_table) : 0.f;
+    for (int j = 1; j < CLASS_NUM; j++) {
+      out[i].result[j].cls = -1;
+      out[i].result[j].score = 0.f;
+      out[i].result[j].margin = 0.f;
+    }
+    out[i].id = ids ? ids[i] : i;
   }
 }
 
@@ -596,143 +628,30 @@ void softmax(float* array, int size) {
 
 
 
-std::vector<cv::Mat> synthesize_image(std::vector<resnet_input>& inputs, std::vector<resnet_results>& results_vec) {
-  std::vector<cv::Mat> res;
-
-  int block_height = inputs[0].img.rows;  // 图像块的高度
-  int block_width = inputs[0].img.cols;    // 图像块的宽度
+// 五个类别画布由同一个并行合成器一次渲染. 合成器持有线程池与 tile 指针表, 各调用共享并串行使用
+static std::vector<cv::Mat> compose_classes(const ClassMap& class_map, const std::vector<resnet_input>& inputs,
+                                            const TileLayout* layout) {
+  static std::mutex compositor_lock;
+  static ClassCompositor compositor;
+  const std::vector<int> classes = {0, 1, 2, 3, 4};
 
-  int num_blocks = results_vec.size();  // 获取图像块的数量
-
-  int image_height = ROWS * block_height;  // 合成图像的总高度
-  int image_width = COLS * block_width;    // 合成图像的总宽度
-  int NUM_CLASSES = 5;
-  cv::Mat output_image(image_height, image_width, CV_8UC3, cv::Scalar(0, 0, 0));
-  for(int i = 0; i < NUM_CLASSES; i++){
-      res.push_back(output_image.clone());  // 显式克隆
-  }
-
-  if (ROWS <= 0 || COLS <= 0) {
-      std::cerr << "Invalid ROWS or COLS values!" << std::endl;
-      return cv::Mat();  // 返回空图像表示出错
-  }
-  for (const auto& result : results_vec) {
-      int block_id = result.id;  // 当前图像块的ID
-      if (result.result[0].cls == 0) {  // 如果为pingdi
-          int row_idx = block_id / COLS;  // 计算该块的行索引
-          int col_idx = block_id % COLS;  // 计算该块的列索引
-
-          // 计算该图像块在合成图像中的位置
-          int y_offset = row_idx * block_height;
-          int x_offset = col_idx * block_width;
-
-          if (block_id >= 0 && block_id < inputs.size()) {
-              auto input = inputs[block_id];
-              if (!input.img.empty()) {
-                  if (x_offset + block_width <= image_width && y_offset + block_height <= image_height) {
-                      input.img.copyTo(res[0](cv::Rect(x_offset, y_offset, block_width, block_height)));
-                  } else {
-                      std::cerr << "Block ID " << block_id << " exceeds output image boundaries!" << std::endl;
-                  }
-              } else {
-                  std::cerr << "Input image is empty for block ID: " << block_id << std::endl;
-              }
-          } else {
-              std::cerr << "Block ID out of range: " << block_id << std::endl;
-          }
-      }
-      if (result.result[0].cls == 1) {  // 如果为pingdi
-          int row_idx = block_id / COLS;  // 计算该块的行索引
-          int col_idx = block_id % COLS;  // 计算该块的列索引
-
-          // 计算该图像块在合成图像中的位置
-          int y_offset = row_idx * block_height;
-          int x_offset = col_idx * block_width;
-
-          if (block_id >= 0 && block_id < inputs.size()) {
-              auto input = inputs[block_id];
-              if (!input.img.empty()) {
-                  if (x_offset + block_width <= image_width && y_offset + block_height <= image_height) {
-                      input.img.copyTo(res[1](cv::Rect(x_offset, y_offset, block_width, block_height)));
-                  } else {
-                      std::cerr << "Block ID " << block_id << " exceeds output image boundaries!" << std::endl;
-                  }
-              } else {
-                  std::cerr << "Input image is empty for block ID: " << block_id << std::endl;
-              }
-          } else {
-              std::cerr << "Block ID out of range: " << block_id << std::endl;
-          }
-      }
-      if (result.result[0].cls == 2) {  // 如果为pingdi
-          int row_idx = block_id / COLS;  // 计算该块的行索引
-          int col_idx = block_id % COLS;  // 计算该块的列索引
-
-          // 计算该图像块在合成图像中的位置
-          int y_offset = row_idx * block_height;
-          int x_offset = col_idx * block_width;
-
-          if (block_id >= 0 && block_id < inputs.size()) {
-              auto input = inputs[block_id];
-              if (!input.img.empty()) {
-                  if (x_offset + block_width <= image_width && y_offset + block_height <= image_height) {
-                      input.img.copyTo(res[2](cv::Rect(x_offset, y_offset, block_width, block_height)));
-                  } else {
-                      std::cerr << "Block ID " << block_id << " exceeds output image boundaries!" << std::endl;
-                  }
-              } else {
-                  std::cerr << "Input image is empty for block ID: " << block_id << std::endl;
-              }
-          } else {
-              std::cerr << "Block ID out of range: " << block_id << std::endl;
-          }
-      }      
-      if (result.result[0].cls == 3) {  // 如果为pingdi
-          int row_idx = block_id / COLS;  // 计算该块的行索引
-          int col_idx = block_id % COLS;  // 计算该块的列索引
-
-          // 计算该图像块在合成图像中的位置
-          int y_offset = row_idx * block_height;
-          int x_offset = col_idx * block_width;
-
-          if (block_id >= 0 && block_id < inputs.size()) {
-              auto input = inputs[block_id];
-              if (!input.img.empty()) {
-                  if (x_offset + block_width <= image_width && y_offset + block_height <= image_height) {
-                      input.img.copyTo(res[3](cv::Rect(x_offset, y_offset, block_width, block_height)));
-                  } else {
-                      std::cerr << "Block ID " << block_id << " exceeds output image boundaries!" << std::endl;
-                  }
-              } else {
-                  std::cerr << "Input image is empty for block ID: " << block_id << std::endl;
-              }
-          } else {
-              std::cerr << "Block ID out of range: " << block_id << std::endl;
-          }
-      }
-      if (result.result[0].cls == 4) {  // 如果为pingdi
-          int row_idx = block_id / COLS;  // 计算该块的行索引
-          int col_idx = block_id % COLS;  // 计算该块的列索引
-
-          // 计算该图像块在合成图像中的位置
-          int y_offset = row_idx * block_height;
-          int x_offset = col_idx * block_width;
-
-          if (block_id >= 0 && block_id < inputs.size()) {
-              auto input = inputs[block_id];
-              if (!input.img.empty()) {
-                  if (x_offset + block_width <= image_width && y_offset + block_height <= image_height) {
-                      input.img.copyTo(res[4](cv::Rect(x_offset, y_offset, block_width, block_height)));
-                  } else {
-                      std::cerr << "Block ID " << block_id << " exceeds output image boundaries!" << std::endl;
-                  }
-              } else {
-                  std::cerr << "Input image is empty for block ID: " << block_id << std::endl;
-              }
-          } else {
-              std::cerr << "Block ID out of range: " << block_id << std::endl;
-          }
-      }
+  std::vector<cv::Mat> res;
+  std::lock_guard<std::mutex> lock(compositor_lock);
+  bool ok = layout ? compositor.render(class_map, inputs, *layout, classes, res)
+                   : compositor.render(class_map, inputs, classes, res);
+  if (!ok) {
+    res.assign(classes.size(), cv::Mat());
   }
   return res;
 }
+
+std::vector<cv::Mat> synthesize_image(std::vector<resnet_input>& inputs, std::vector<resnet_results>& results_vec) {
+  // 每个类别一张全尺寸图; 只需要类别网格时直接使用 ClassMap, 避免渲染
+  ClassMap class_map = ClassMap::from_results(results_vec);
+  return compose_classes(class_map, inputs, nullptr);
+}
+
+std::vector<cv::Mat> synthesize_image(std::vector<resnet_input>& inputs, std::vector<resnet_results>& results_vec, const TileLayout& layout) {
+  ClassMap class_map = ClassMap::from_results(results_vec, layout.rows, layout.cols);
+  return compose_classes(class_map, inputs, &layout);
+}
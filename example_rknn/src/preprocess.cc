@@ -19,6 +19,7 @@
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/imgproc.hpp"
 #include "postprocess.h"
+#include "preprocess.h"
 
 void letterbox(const cv::Mat &image, cv::Mat &padded_image, BOX_RECT &pads, const float scale, const cv::Size &target_size, const cv::Scalar &pad_color)
 {
@@ -64,4 +65,341 @@ int resize_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::M
     }
     IM_STATUS STATUS = imresize(src, dst);
     return 0;
-}
\ No newline at end of file
+}
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <string.h>
+
+#define RESIZE_BITS 7
+#define RESIZE_SCALE (1 << RESIZE_BITS)
+#define RESIZE_SHIFT (RESIZE_BITS * 2)
+
+// 与 OpenCV INTER_LINEAR 相同的像素中心映射, 返回左侧坐标和 7 位定点的右侧权重
+static inline void linear_coord(int d, float scale, int src_len, int &i0, int &i1, uint8_t &w)
+{
+    float f = (d + 0.5f) * scale - 0.5f;
+    if (f < 0.f)
+        f = 0.f;
+    i0 = (int)f;
+    if (i0 >= src_len - 1)
+    {
+        i0 = src_len - 1;
+        f = (float)i0;
+    }
+    i1 = i0 + 1 < src_len ? i0 + 1 : i0;
+    w = (uint8_t)(int)((f - i0) * RESIZE_SCALE + 0.5f);
+}
+
+static inline int nearest_coord(int d, float scale, int src_len)
+{
+    int i = (int)(d * scale);
+    return i < src_len ? i : src_len - 1;
+}
+
+// dst[i] = (r0[i] * (128 - w) + r1[i] * w + 2^13) >> 14
+static void vertical_blend(const uint16_t *r0, const uint16_t *r1, int w, uint8_t *dst, int n)
+{
+    int i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint16x4_t w0 = vdup_n_u16((uint16_t)(RESIZE_SCALE - w));
+    uint16x4_t w1 = vdup_n_u16((uint16_t)w);
+    for (; i + 8 <= n; i += 8)
+    {
+        uint16x8_t a = vld1q_u16(r0 + i);
+        uint16x8_t b = vld1q_u16(r1 + i);
+        uint32x4_t lo = vmlal_u16(vmull_u16(vget_low_u16(a), w0), vget_low_u16(b), w1);
+        uint32x4_t hi = vmlal_u16(vmull_u16(vget_high_u16(a), w0), vget_high_u16(b), w1);
+        uint16x8_t v = vcombine_u16(vrshrn_n_u32(lo, RESIZE_SHIFT), vrshrn_n_u32(hi, RESIZE_SHIFT));
+        vst1_u8(dst + i, vqmovn_u16(v));
+    }
+#elif defined(__AVX2__)
+    // 行缓存中的值不超过 255 * 128, 可按有符号 16 位交织后用 madd 一次完成两项乘加
+    __m256i wv = _mm256_set1_epi32((w << 16) | (RESIZE_SCALE - w));
+    __m256i round = _mm256_set1_epi32(1 << (RESIZE_SHIFT - 1));
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(r0 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(r1 + i));
+        __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), wv);
+        __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), wv);
+        lo = _mm256_srai_epi32(_mm256_add_epi32(lo, round), RESIZE_SHIFT);
+        hi = _mm256_srai_epi32(_mm256_add_epi32(hi, round), RESIZE_SHIFT);
+        __m256i v16 = _mm256_packs_epi32(lo, hi);
+        __m256i v8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(v16, v16), 0x08);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm256_castsi256_si128(v8));
+    }
+#elif defined(__SSE2__)
+    __m128i wv = _mm_set1_epi32((w << 16) | (RESIZE_SCALE - w));
+    __m128i round = _mm_set1_epi32(1 << (RESIZE_SHIFT - 1));
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(r0 + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(r1 + i));
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), wv);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), wv);
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), RESIZE_SHIFT);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), RESIZE_SHIFT);
+        __m128i v16 = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(v16, v16));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        uint32_t v = (uint32_t)r0[i] * (RESIZE_SCALE - w) + (uint32_t)r1[i] * w;
+        dst[i] = (uint8_t)((v + (1 << (RESIZE_SHIFT - 1))) >> RESIZE_SHIFT);
+    }
+}
+
+// 逐行交换 B/R. NEON 用 vld3/vst3 一次 16 像素; x86 需要 SSSE3 的 pshufb, 每次处理 5 个像素 (15 字节),
+// 第 16 个字节由下一轮或标量尾部覆盖
+static void swap_rb_row(const uint8_t *s, uint8_t *d, int w)
+{
+    int x = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; x + 16 <= w; x += 16)
+    {
+        uint8x16x3_t v = vld3q_u8(s + x * 3);
+        uint8x16_t t = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = t;
+        vst3q_u8(d + x * 3, v);
+    }
+#elif defined(__SSSE3__)
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    for (; (x + 5) * 3 + 1 <= w * 3; x += 5)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + x * 3));
+        _mm_storeu_si128((__m128i *)(d + x * 3), _mm_shuffle_epi8(v, mask));
+    }
+#endif
+    for (; x < w; x++)
+    {
+        d[x * 3] = s[x * 3 + 2];
+        d[x * 3 + 1] = s[x * 3 + 1];
+        d[x * 3 + 2] = s[x * 3];
+    }
+}
+
+static inline uint32_t load_pixel(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+FusedPreprocessor::FusedPreprocessor(int dst_w, int dst_h, ResizeInterp interp)
+{
+    reset(dst_w, dst_h, interp);
+}
+
+void FusedPreprocessor::reset(int dst_w, int dst_h, ResizeInterp interp)
+{
+    dst_w_ = dst_w;
+    dst_h_ = dst_h;
+    interp_ = interp;
+    src_w_ = src_h_ = 0;
+    xofs0_.resize(dst_w);
+    xofs1_.resize(dst_w);
+    xw_.resize(dst_w);
+    yofs_.resize(dst_h);
+    yw_.resize(dst_h);
+    xw0_.resize(dst_w * 4);
+    xw1_.resize(dst_w * 4);
+    // SIMD 每两个像素存 8 个 uint16, 末尾多出的两个需要余量
+    rows_[0].resize(dst_w * 3 + 2);
+    rows_[1].resize(dst_w * 3 + 2);
+}
+
+void FusedPreprocessor::build_tables(int src_w, int src_h)
+{
+    float sx = (float)src_w / dst_w_;
+    float sy = (float)src_h / dst_h_;
+    for (int x = 0; x < dst_w_; x++)
+    {
+        if (interp_ == ResizeInterp::Nearest)
+        {
+            xofs0_[x] = xofs1_[x] = nearest_coord(x, sx, src_w) * 3;
+            xw_[x] = 0;
+            continue;
+        }
+        int x0, x1;
+        linear_coord(x, sx, src_w, x0, x1, xw_[x]);
+        xofs0_[x] = x0 * 3;
+        xofs1_[x] = x1 * 3;
+    }
+    // SIMD 水平插值每个像素读 4 字节, 只用于第 4 字节仍在行内的前缀, 其余走标量
+    hsimd_w_ = 0;
+    while (hsimd_w_ < dst_w_ && xofs1_[hsimd_w_] + 4 <= src_w * 3)
+        hsimd_w_++;
+    for (int x = 0; x < dst_w_; x++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            xw0_[x * 4 + c] = (uint16_t)(RESIZE_SCALE - xw_[x]);
+            xw1_[x * 4 + c] = xw_[x];
+        }
+    }
+    for (int y = 0; y < dst_h_; y++)
+    {
+        if (interp_ == ResizeInterp::Nearest)
+        {
+            yofs_[y] = nearest_coord(y, sy, src_h);
+            yw_[y] = 0;
+            continue;
+        }
+        int y0, y1;
+        linear_coord(y, sy, src_h, y0, y1, yw_[y]);
+        yofs_[y] = y0;
+    }
+    src_w_ = src_w;
+    src_h_ = src_h;
+    row_tag_[0] = row_tag_[1] = -1;
+}
+
+// 对一行源像素做水平插值并交换 B/R, 结果缓存在 slot 中, 放大时相邻目标行可以复用
+const uint16_t *FusedPreprocessor::horizontal_row(const cv::Mat &src, int sy, int slot)
+{
+    if (row_tag_[slot] == sy)
+        return rows_[slot].data();
+    if (row_tag_[slot ^ 1] == sy)
+        return rows_[slot ^ 1].data();
+
+    const uint8_t *s = src.ptr<uint8_t>(sy);
+    uint16_t *d = rows_[slot].data();
+    int x = 0;
+    // 每次两个像素: 各读 4 字节 (BGRx) 扩成 16 位, 与按像素展开的权重相乘相加, 再重排成 RGB.
+    // 8 个 uint16 的存储比 6 个有效值多写两个, 由下一轮覆盖, 行尾由 rows_ 的余量兜住
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+    const uint8x16_t order = {4, 5, 2, 3, 0, 1, 12, 13, 10, 11, 8, 9, 6, 7, 14, 15};
+    for (; x + 2 <= hsimd_w_; x += 2, d += 6)
+    {
+        uint64_t a = load_pixel(s + xofs0_[x]) | (uint64_t)load_pixel(s + xofs0_[x + 1]) << 32;
+        uint64_t b = load_pixel(s + xofs1_[x]) | (uint64_t)load_pixel(s + xofs1_[x + 1]) << 32;
+        uint16x8_t v = vmulq_u16(vmovl_u8(vcreate_u8(a)), vld1q_u16(&xw0_[x * 4]));
+        v = vmlaq_u16(v, vmovl_u8(vcreate_u8(b)), vld1q_u16(&xw1_[x * 4]));
+        vst1q_u16(d, vreinterpretq_u16_u8(vqtbl1q_u8(vreinterpretq_u8_u16(v), order)));
+    }
+#elif defined(__SSSE3__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i order = _mm_setr_epi8(4, 5, 2, 3, 0, 1, 12, 13, 10, 11, 8, 9, 6, 7, 14, 15);
+    for (; x + 2 <= hsimd_w_; x += 2, d += 6)
+    {
+        __m128i a = _mm_unpacklo_epi32(_mm_cvtsi32_si128((int)load_pixel(s + xofs0_[x])),
+                                       _mm_cvtsi32_si128((int)load_pixel(s + xofs0_[x + 1])));
+        __m128i b = _mm_unpacklo_epi32(_mm_cvtsi32_si128((int)load_pixel(s + xofs1_[x])),
+                                       _mm_cvtsi32_si128((int)load_pixel(s + xofs1_[x + 1])));
+        __m128i v = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_loadu_si128((const __m128i *)&xw0_[x * 4])),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), _mm_loadu_si128((const __m128i *)&xw1_[x * 4])));
+        _mm_storeu_si128((__m128i *)d, _mm_shuffle_epi8(v, order));
+    }
+#endif
+    for (; x < dst_w_; x++)
+    {
+        const uint8_t *p0 = s + xofs0_[x];
+        const uint8_t *p1 = s + xofs1_[x];
+        int w1 = xw_[x];
+        int w0 = RESIZE_SCALE - w1;
+        d[0] = (uint16_t)(p0[2] * w0 + p1[2] * w1);
+        d[1] = (uint16_t)(p0[1] * w0 + p1[1] * w1);
+        d[2] = (uint16_t)(p0[0] * w0 + p1[0] * w1);
+        d += 3;
+    }
+    row_tag_[slot] = sy;
+    return rows_[slot].data();
+}
+
+bool FusedPreprocessor::run(const cv::Mat &src, uint8_t *dst)
+{
+    if (src.empty() || src.type() != CV_8UC3 || dst == nullptr || dst_w_ <= 0 || dst_h_ <= 0)
+        return false;
+    // 行缓存只对本次 src 有效, 同尺寸的另一个 tile 不能复用
+    row_tag_[0] = row_tag_[1] = -1;
+
+    // 尺寸一致时只需交换通道
+    if (src.cols == dst_w_ && src.rows == dst_h_)
+    {
+        for (int y = 0; y < dst_h_; y++)
+        {
+            swap_rb_row(src.ptr<uint8_t>(y), dst + (size_t)y * dst_w_ * 3, dst_w_);
+        }
+        return true;
+    }
+
+    if (src.cols != src_w_ || src.rows != src_h_)
+        build_tables(src.cols, src.rows);
+
+    const int row_len = dst_w_ * 3;
+    if (interp_ == ResizeInterp::Nearest)
+    {
+        for (int y = 0; y < dst_h_; y++)
+        {
+            const uint8_t *s = src.ptr<uint8_t>(yofs_[y]);
+            uint8_t *d = dst + (size_t)y * row_len;
+            for (int x = 0; x < dst_w_; x++, d += 3)
+            {
+                const uint8_t *p = s + xofs0_[x];
+                d[0] = p[2];
+                d[1] = p[1];
+                d[2] = p[0];
+            }
+        }
+        return true;
+    }
+
+    for (int y = 0; y < dst_h_; y++)
+    {
+        int y0 = yofs_[y];
+        int y1 = y0 + 1 < src_h_ ? y0 + 1 : y0;
+        // 偶数源行固定放 slot 0, 奇数放 slot 1, 相邻两行不会互相覆盖
+        const uint16_t *r0 = horizontal_row(src, y0, y0 & 1);
+        const uint16_t *r1 = horizontal_row(src, y1, y1 & 1);
+        vertical_blend(r0, r1, yw_[y], dst + (size_t)y * row_len, row_len);
+    }
+    return true;
+}
+
+void fused_preprocess_reference(const cv::Mat &src, uint8_t *dst, int dst_w, int dst_h, ResizeInterp interp)
+{
+    float sx = (float)src.cols / dst_w;
+    float sy = (float)src.rows / dst_h;
+    for (int y = 0; y < dst_h; y++)
+    {
+        for (int x = 0; x < dst_w; x++)
+        {
+            uint8_t *d = dst + ((size_t)y * dst_w + x) * 3;
+            if (interp == ResizeInterp::Nearest || (src.cols == dst_w && src.rows == dst_h))
+            {
+                int ny = src.rows == dst_h ? y : nearest_coord(y, sy, src.rows);
+                int nx = src.cols == dst_w ? x : nearest_coord(x, sx, src.cols);
+                const uint8_t *p = src.ptr<uint8_t>(ny) + nx * 3;
+                d[0] = p[2];
+                d[1] = p[1];
+                d[2] = p[0];
+                continue;
+            }
+            int x0, x1, y0, y1;
+            uint8_t wx, wy;
+            linear_coord(x, sx, src.cols, x0, x1, wx);
+            linear_coord(y, sy, src.rows, y0, y1, wy);
+            const uint8_t *s0 = src.ptr<uint8_t>(y0);
+            const uint8_t *s1 = src.ptr<uint8_t>(y1);
+            for (int c = 0; c < 3; c++)
+            {
+                int sc = 2 - c;
+                uint32_t h0 = s0[x0 * 3 + sc] * (RESIZE_SCALE - wx) + s0[x1 * 3 + sc] * wx;
+                uint32_t h1 = s1[x0 * 3 + sc] * (RESIZE_SCALE - wx) + s1[x1 * 3 + sc] * wx;
+                uint32_t v = h0 * (RESIZE_SCALE - wy) + h1 * wy;
+                d[c] = (uint8_t)((v + (1 << (RESIZE_SHIFT - 1))) >> RESIZE_SHIFT);
+            }
+        }
+    }
+}
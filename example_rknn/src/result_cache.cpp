@@ -0,0 +1,155 @@
+#include "result_cache.hpp"
+#include <string.h>
+#include <algorithm>
+
+static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t mix_round(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME1;
+}
+
+static inline uint64_t load64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 四路独立累加器按 32 字节条带吃进每一行, 行尾不足 8 字节的部分补零后并入
+uint64_t hash_tile(const cv::Mat &tile, int ignore_low_bits)
+{
+    if (tile.empty()) {
+        return 0;
+    }
+
+    uint8_t byte_mask = (uint8_t)(0xFF << std::min(std::max(ignore_low_bits, 0), 7));
+    uint64_t mask = 0x0101010101010101ULL * byte_mask;
+    uint64_t v[4] = {PRIME1 + PRIME2, PRIME2, 0, 0 - PRIME1};
+    size_t bytes = tile.cols * tile.elemSize();
+    for (int y = 0; y < tile.rows; y++) {
+        const uint8_t *p = tile.ptr<uint8_t>(y);
+        size_t i = 0;
+        for (; i + 32 <= bytes; i += 32) {
+            v[0] = mix_round(v[0], load64(p + i) & mask);
+            v[1] = mix_round(v[1], load64(p + i + 8) & mask);
+            v[2] = mix_round(v[2], load64(p + i + 16) & mask);
+            v[3] = mix_round(v[3], load64(p + i + 24) & mask);
+        }
+        for (int k = 0; i + 8 <= bytes; i += 8, k++) {
+            v[k] = mix_round(v[k], load64(p + i) & mask);
+        }
+        if (i < bytes) {
+            uint64_t tail = 0;
+            memcpy(&tail, p + i, bytes - i);
+            v[3] = mix_round(v[3], tail & mask);
+        }
+    }
+
+    uint64_t h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+    h ^= ((uint64_t)tile.rows << 40 | (uint64_t)tile.cols << 16 | (uint64_t)tile.type()) * PRIME3;
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+ResultCache::ResultCache(const ResultCacheParams &params) : params_(params)
+{
+    int shards = std::max(params_.shards, 1);
+    size_t per_shard = std::max<size_t>((params_.capacity + shards - 1) / shards, 1);
+    for (int i = 0; i < shards; i++) {
+        shards_.emplace_back(new Shard());
+        shards_.back()->slots.resize(per_shard);
+        shards_.back()->index.reserve(per_shard);
+    }
+}
+
+bool ResultCache::lookup(uint64_t key, resnet_results &out)
+{
+    Shard &shard = shard_of(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            Slot &slot = shard.slots[it->second];
+            slot.referenced = true;
+            out = slot.value;
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void ResultCache::insert(uint64_t key, const resnet_results &value)
+{
+    Shard &shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.slots[it->second].value = value;
+        return;
+    }
+
+    // CLOCK: 指针扫过时清掉引用位, 停在第一个空位或未被引用的条目上
+    size_t n = shard.slots.size();
+    while (shard.slots[shard.hand].used && shard.slots[shard.hand].referenced) {
+        shard.slots[shard.hand].referenced = false;
+        shard.hand = (shard.hand + 1) % n;
+    }
+    Slot &slot = shard.slots[shard.hand];
+    if (slot.used) {
+        shard.index.erase(slot.key);
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        shard.used++;
+    }
+    slot.key = key;
+    slot.value = value;
+    slot.used = true;
+    slot.referenced = false;
+    shard.index[key] = (uint32_t)shard.hand;
+    shard.hand = (shard.hand + 1) % n;
+    inserts_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ResultCache::clear()
+{
+    for (auto &shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mtx);
+        shard->index.clear();
+        for (auto &slot : shard->slots) {
+            slot.used = false;
+            slot.referenced = false;
+        }
+        shard->hand = 0;
+        shard->used = 0;
+    }
+}
+
+ResultCacheStats ResultCache::stats() const
+{
+    ResultCacheStats stats;
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.evictions = evictions_.load(std::memory_order_relaxed);
+    stats.inserts = inserts_.load(std::memory_order_relaxed);
+    for (auto &shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mtx);
+        stats.size += shard->used;
+    }
+    return stats;
+}
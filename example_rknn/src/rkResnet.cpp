@@ -8,12 +8,66 @@
 #include "opencv2/imgproc/imgproc.hpp"
 #include "coreNum.hpp"
 #include "utils.hpp"
+#include "postprocess.h"
+#include "topk.h"
+#include "class_map.hpp"
 #include "ilogger.h" // 假设你有这个日志库
+#include "trace.h"
+#include <chrono>
+#include <algorithm>
+#include <string.h>
+
+static inline int64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void rkResnetStats::merge(const rkResnetStats &other)
+{
+    runs += other.runs;
+    preprocess_us += other.preprocess_us;
+    run_us += other.run_us;
+    npu_us += other.npu_us;
+    postprocess_us += other.postprocess_us;
+    if (!other.layer_detail.empty()) {
+        layer_detail = other.layer_detail;
+    }
+}
+
+std::vector<rkResnetStats> merge_stats_by_core(const std::vector<rkResnetStats> &stats)
+{
+    std::vector<rkResnetStats> per_core(RK3588);
+    for (int i = 0; i < RK3588; i++) {
+        per_core[i].core_id = i;
+    }
+    for (const auto &s : stats) {
+        if (s.core_id >= 0 && s.core_id < RK3588) {
+            per_core[s.core_id].merge(s);
+        }
+    }
+    return per_core;
+}
+
+void print_stats(const std::vector<rkResnetStats> &stats)
+{
+    for (const auto &s : stats) {
+        if (s.runs == 0) continue;
+        double n = (double)s.runs;
+        double host_us = (s.preprocess_us + s.postprocess_us) / n;
+        printf("core %d | runs %lld | pre %.1f us | run %.1f us (npu %.1f us) | post %.1f us | %s\n",
+               s.core_id, (long long)s.runs, s.preprocess_us / n, s.run_us / n, s.npu_us / n,
+               s.postprocess_us / n, host_us > s.run_us / n ? "CPU-bound" : "NPU-bound");
+        if (!s.layer_detail.empty()) {
+            printf("%s\n", s.layer_detail.c_str());
+        }
+    }
+}
 
 // 构造函数
-rkResnet::rkResnet(const std::string &model_path)
+rkResnet::rkResnet(const rkResnetParams &params) : params(params)
 {
-    this->model_path = model_path;
+    this->model_path = params.model_path;
     
     // 【修改3】构造时立即初始化，适应 main 函数的逻辑
     // 如果是单线程串行，传入 nullptr 和 false
@@ -43,7 +97,8 @@ int rkResnet::init(rknn_context *ctx_in, bool share_weight)
         ret = rknn_dup_context(ctx_in, &ctx);
     }
     else{
-        ret = rknn_init(&ctx, model_data, model_data_size, 0, NULL);
+        uint32_t flag = params.profile_layers ? RKNN_FLAG_COLLECT_PERF_MASK : 0;
+        ret = rknn_init(&ctx, model_data, model_data_size, flag, NULL);
     }
     
     if (ret < 0) {
@@ -53,7 +108,8 @@ int rkResnet::init(rknn_context *ctx_in, bool share_weight)
 
     // 设置核心 (保留你的逻辑)
     rknn_core_mask core_mask = RKNN_NPU_CORE_AUTO; // 建议默认 AUTO，或者保留你的 switch
-    switch (get_core_num()) {
+    stats.core_id = get_core_num();
+    switch (stats.core_id) {
         case 0: core_mask = RKNN_NPU_CORE_0; break;
         case 1: core_mask = RKNN_NPU_CORE_1; break;
         case 2: core_mask = RKNN_NPU_CORE_2; break;
@@ -103,83 +159,253 @@ int rkResnet::init(rknn_context *ctx_in, bool share_weight)
     inputs[0].fmt = RKNN_TENSOR_NHWC;
     inputs[0].pass_through = 0;
 
+    preproc.reset(width, height);
+    input_buf.resize(width * height * channel);
+    num_classes = io_num.n_output > 0 ? (int)output_attrs[0].n_elems : 0;
+    logits_buf.resize(num_classes);
+
+    // scale > 0 时反量化单调, 整数域的 argmax 与 float softmax 一致
+    quant_out = params.int8_argmax && CLASS_NUM == 1 && io_num.n_output > 0 &&
+                output_attrs[0].type == RKNN_TENSOR_INT8 &&
+                output_attrs[0].qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC && output_attrs[0].scale > 0.f;
+    if (quant_out) {
+        out_scale = output_attrs[0].scale;
+        build_exp_table_i8(out_scale, exp_table);
+        qlogits_buf.resize(num_classes);
+    } else if (params.int8_argmax && !share_weight) {
+        printf("int8 argmax unavailable for output type %s, using float postprocess\n",
+               get_type_string(output_attrs[0].type));
+    }
+
     return 0;
 }
 
 rknn_context *rkResnet::get_pctx() { return &ctx; }
 
-resnet_results rkResnet::Predict(resnet_input& input)
+// src 的前处理 + NPU 推理, 第一个输出拷入 logits 缓冲的第 slot 行 (int8 路径为 qlogits_buf). 调用方持有 mtx 并保证缓冲足够
+int rkResnet::infer(const cv::Mat& src, int slot)
 {
-    // 检查 ctx 是否有效
-    if (ctx == 0) {
-        printf("Error: Context is null in Predict.\n");
-        return resnet_results();
-    }
+    const bool profile = params.enable_profile;
+    int64_t t_pre = profile ? now_us() : 0;
 
-    std::lock_guard<std::mutex> lock(mtx);
-    
     cv::Mat img;
-    // 确保输入不为空
-    if (input.img.empty()) {
-         return resnet_results();
-    }
-
-    // 转换颜色
-    cv::cvtColor(input.img, img, cv::COLOR_BGR2RGB);
-
-    // 【修改4】处理尺寸不匹配问题
-    // 你的代码之前在 img_width != width 时才处理，这很好。
-    // 但必须确保 inputs[0].buf 指向的数据是有效的且大小正确。
-    
     cv::Mat resized_img;
-    
-    if (img.cols != width || img.rows != height) {
-        // 简单处理：直接 resize (Letterbox 更好，但为了排查 crash，先用最稳的)
-        // 注意：resized_img 是局部变量，它的 data 指针只在 Predict 函数内有效
-        // 只要 rknn_run 在函数返回前执行完毕即可。
-        cv::resize(img, resized_img, cv::Size(width, height));
-        inputs[0].buf = resized_img.data;
+
+    if (src.type() == CV_8UC3 && channel == 3) {
+        // 单趟完成 BGR->RGB 与缩放, 直接从父图 ROI 读取并写入常驻的输入缓冲
+        PP_TRACE_SCOPE_CAT("cvtColor+resize", "rknn");
+        preproc.run(src, input_buf.data());
+        inputs[0].buf = input_buf.data();
     } else {
-        inputs[0].buf = img.data;
+        // 转换颜色
+        {
+            PP_TRACE_SCOPE_CAT("cvtColor", "rknn");
+            cv::cvtColor(src, img, cv::COLOR_BGR2RGB);
+        }
+
+        if (img.cols != width || img.rows != height) {
+            // 注意：resized_img 是局部变量，它的 data 指针只在 infer 函数内有效
+            // 只要 rknn_run 在函数返回前执行完毕即可。
+            PP_TRACE_SCOPE_CAT("resize", "rknn");
+            cv::resize(img, resized_img, cv::Size(width, height));
+            inputs[0].buf = resized_img.data;
+        } else {
+            inputs[0].buf = img.data;
+        }
     }
 
     // 设置输入
-    rknn_inputs_set(ctx, io_num.n_input, inputs);
+    {
+        PP_TRACE_SCOPE_CAT("rknn_inputs_set", "rknn");
+        rknn_inputs_set(ctx, io_num.n_input, inputs);
+    }
+
+    int64_t t_run = profile ? now_us() : 0;
 
     // 准备输出 buffer
     rknn_output outputs[io_num.n_output];
     memset(outputs, 0, sizeof(outputs));
     for (int i = 0; i < io_num.n_output; i++) {
-        outputs[i].want_float = 1;
+        outputs[i].want_float = !(quant_out && i == 0);
     }
 
     // 推理
-    ret = rknn_run(ctx, NULL);
+    {
+        PP_TRACE_SCOPE_CAT("rknn_run", "rknn");
+        ret = rknn_run(ctx, NULL);
+    }
     if (ret < 0) {
-        printf("rknn_run failed %d\n", ret);
-        return resnet_results();
+        INFOE_EVERY_MS(1000, "rknn_run failed %d", ret);
+        return -1;
     }
-    
-    ret = rknn_outputs_get(ctx, io_num.n_output, outputs, NULL);
 
-    // 后处理
-    // 假设 softmax 和 get_topk_with_indices 是安全的
-    if(output_attrs && outputs[0].buf) {
-        softmax((float*)outputs[0].buf, output_attrs[0].n_elems);
+    int64_t t_post = profile ? now_us() : 0;
+
+    {
+        PP_TRACE_SCOPE_CAT("rknn_outputs_get", "rknn");
+        ret = rknn_outputs_get(ctx, io_num.n_output, outputs, NULL);
     }
-    
-    resnet_results results;
+    if (ret < 0) {
+        INFOE_EVERY_MS(1000, "rknn_outputs_get failed %d", ret);
+        return -1;
+    }
+    if (!outputs[0].buf) {
+        rknn_outputs_release(ctx, io_num.n_output, outputs);
+        return -1;
+    }
+    if (quant_out) {
+        memcpy(qlogits_buf.data() + (size_t)slot * num_classes, outputs[0].buf, num_classes);
+    } else {
+        memcpy(logits_buf.data() + (size_t)slot * num_classes, outputs[0].buf, num_classes * sizeof(float));
+    }
+    rknn_outputs_release(ctx, io_num.n_output, outputs);
+
+    if (profile) {
+        rknn_perf_run perf_run;
+        memset(&perf_run, 0, sizeof(perf_run));
+        rknn_query(ctx, RKNN_QUERY_PERF_RUN, &perf_run, sizeof(perf_run));
+
+        stats.runs++;
+        stats.preprocess_us += t_run - t_pre;
+        stats.run_us += t_post - t_run;
+        stats.npu_us += perf_run.run_duration;
+        stats.postprocess_us += now_us() - t_post;
+    }
+    return 0;
+}
+
+resnet_results rkResnet::Predict(resnet_input& input)
+{
+    // 与 PredictBatch 一致: 失败时保留 tile 的 id 并标记为 NO_LABEL, 调用方按 id 回填时不会覆盖 0 号 tile
+    resnet_results results = resnet_results();
     results.id = input.id;
-    
-    if(outputs[0].buf) {
-        get_topk_with_indices((float*)outputs[0].buf, output_attrs[0].n_elems, results);
+    results.result[0].cls = ClassMap::NO_LABEL;
+
+    // 检查 ctx 是否有效
+    if (ctx == 0) {
+        INFOE_FIRST_N(10, "Context is null in Predict.");
+        return results;
+    }
+    // 确保输入不为空
+    if (input.img.empty()) {
+        return results;
     }
 
-    rknn_outputs_release(ctx, io_num.n_output, outputs);
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if (infer(input.img, 0) < 0) {
+        return results;
+    }
+
+    // 后处理
+    int64_t t_post = params.enable_profile ? now_us() : 0;
+    classify(1, &input.id, &results);
+    if (params.enable_profile) {
+        stats.postprocess_us += now_us() - t_post;
+    }
+    return results;
+}
+
+void rkResnet::classify(int n, const int* ids, resnet_results* out)
+{
+    // softmax 与 top-k 在 classify_batch 中融合为一趟, 只能整体计时
+    PP_TRACE_SCOPE_CAT("softmax+topk", "rknn");
+    if (quant_out) {
+        classify_batch_i8(qlogits_buf.data(), n, num_classes, out_scale,
+                          params.int8_winner_prob ? exp_table : nullptr, ids, out);
+    } else {
+        classify_batch(logits_buf.data(), n, num_classes, ids, out);
+    }
+}
 
+std::vector<resnet_results> rkResnet::PredictBatch(std::vector<resnet_input>& tiles)
+{
+    // 结果按 tile 顺序对应, 空图或推理失败的 tile 保留自己的 id 并标记为 NO_LABEL,
+    // 避免调用方按 id 回填时覆盖 0 号 tile
+    std::vector<resnet_results> results(tiles.size());
+    for (size_t i = 0; i < tiles.size(); i++) {
+        results[i].id = tiles[i].id;
+        results[i].result[0].cls = ClassMap::NO_LABEL;
+        results[i].result[0].score = 0.f;
+        results[i].result[0].margin = 0.f;
+    }
+    if (ctx == 0) {
+        INFOE_FIRST_N(10, "Context is null in PredictBatch.");
+        return results;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    // 成功推理的 tile 依次写入 [n, classes] 的 logits 块
+    size_t count = tiles.size();
+    if (quant_out) {
+        qlogits_buf.resize(std::max(qlogits_buf.size(), count * num_classes));
+    } else {
+        logits_buf.resize(std::max(logits_buf.size(), count * num_classes));
+    }
+    batch_ids.resize(count);
+    batch_slots.resize(count);
+    batch_results.resize(count);
+    // 先按源图行扫描把整批 tile 打包成连续的 [n, h, w, c] 缓冲, 父图每条缓存行只读一次,
+    // 之后的前处理读连续内存而不是分散在父图各处的 ROI. 尺寸与首个 tile 不同的 tile (如 Pad 之外的边缘块)
+    // 不参与打包, 仍从原 ROI 前处理, 避免补零改变缩放结果
+    int tile_w = 0, tile_h = 0;
+    for (const auto& tile : tiles) {
+        if (!tile.img.empty() && tile.img.type() == CV_8UC3) {
+            tile_w = tile.img.cols;
+            tile_h = tile.img.rows;
+            break;
+        }
+    }
+    TileBatchPool::Handle packed = batch_pool.acquire();
+    if (tile_w > 0) {
+        PP_TRACE_SCOPE_CAT("pack_tile_batch", "rknn");
+        pack_tile_batch(tiles, 0, (int)count, tile_w, tile_h, *packed);
+    }
+
+    int n = 0;
+    for (size_t i = 0; i < count; i++) {
+        const cv::Mat& img = tiles[i].img;
+        if (img.empty()) {
+            continue;
+        }
+        bool use_packed = tile_w > 0 && img.type() == CV_8UC3 && img.cols == tile_w && img.rows == tile_h;
+        cv::Mat src = use_packed ? cv::Mat(tile_h, tile_w, CV_8UC3, packed->tile((int)i)) : img;
+        if (infer(src, n) == 0) {
+            batch_ids[n] = tiles[i].id;
+            batch_slots[n] = (int)i;
+            n++;
+        }
+    }
+
+    // 整批只做一次 softmax + top-k
+    int64_t t_post = params.enable_profile ? now_us() : 0;
+    classify(n, batch_ids.data(), batch_results.data());
+    for (int k = 0; k < n; k++) {
+        results[batch_slots[k]] = batch_results[k];
+    }
+    if (params.enable_profile) {
+        stats.postprocess_us += now_us() - t_post;
+    }
     return results;
 }
 
+rkResnetStats rkResnet::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+
+    // 逐层耗时只反映最近一次 rknn_run, 在取统计时才查询, 避免每次推理都拷贝大段文本
+    if (params.profile_layers && ctx != 0 && stats.runs > 0) {
+        rknn_perf_detail perf_detail;
+        memset(&perf_detail, 0, sizeof(perf_detail));
+        if (rknn_query(ctx, RKNN_QUERY_PERF_DETAIL, &perf_detail, sizeof(perf_detail)) == RKNN_SUCC &&
+            perf_detail.perf_data != nullptr) {
+            stats.layer_detail.assign(perf_detail.perf_data, perf_detail.data_len);
+        }
+    }
+    return stats;
+}
+
 rkResnet::~rkResnet()
 {
     if (ctx > 0) {
@@ -0,0 +1,514 @@
+#include "softmax.h"
+#include "topk.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define EXP_HI 88.3762626647949f
+#define EXP_LO -87.0f
+#define LOG2E 1.44269504088896341f
+#define LN2_HI 0.693359375f
+#define LN2_LO -2.12194440e-4f
+#define EXP_P0 1.9875691500E-4f
+#define EXP_P1 1.3981999507E-3f
+#define EXP_P2 8.3334519073E-3f
+#define EXP_P3 4.1665795894E-2f
+#define EXP_P4 1.6666665459E-1f
+#define EXP_P5 5.0000001201E-1f
+
+// 块长 64 个元素, 块内数据先求最大值再求 exp 时仍在 L1 中
+#define SOFTMAX_BLOCK 64
+#define SOFTMAX_MAX_SEGMENTS 16
+// 类别数不超过它的行走窄行路径 (分类头通常只有几个类别)
+#define SOFTMAX_NARROW 16
+
+static inline float exp_poly(float x)
+{
+    x = std::min(std::max(x, EXP_LO), EXP_HI);
+    // |x * LOG2E| < 2^22, 加减 1.5 * 2^23 即就近取整
+    float n = (x * LOG2E + 12582912.f) - 12582912.f;
+    float r = x - n * LN2_HI - n * LN2_LO;
+    float y = EXP_P0;
+    y = y * r + EXP_P1;
+    y = y * r + EXP_P2;
+    y = y * r + EXP_P3;
+    y = y * r + EXP_P4;
+    y = y * r + EXP_P5;
+    y = y * r * r + r + 1.f;
+    int32_t bits;
+    memcpy(&bits, &y, sizeof(bits));
+    bits += (int32_t)n << 23;
+    memcpy(&y, &bits, sizeof(y));
+    return y;
+}
+
+float fast_expf(float x)
+{
+    return exp_poly(x);
+}
+
+// --- 各指令集的最小向量抽象, 下方内核只写一遍 ---
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SOFTMAX_LANES 4
+typedef float32x4_t vfloat;
+static inline vfloat v_load(const float *p) { return vld1q_f32(p); }
+static inline void v_store(float *p, vfloat v) { vst1q_f32(p, v); }
+static inline vfloat v_set(float x) { return vdupq_n_f32(x); }
+static inline vfloat v_add(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+static inline vfloat v_sub(vfloat a, vfloat b) { return vsubq_f32(a, b); }
+static inline vfloat v_mul(vfloat a, vfloat b) { return vmulq_f32(a, b); }
+static inline vfloat v_fma(vfloat a, vfloat b, vfloat c) { return vfmaq_f32(c, a, b); }
+static inline vfloat v_max(vfloat a, vfloat b) { return vmaxq_f32(a, b); }
+static inline vfloat v_min(vfloat a, vfloat b) { return vminq_f32(a, b); }
+static inline float v_hmax(vfloat v) { return vmaxvq_f32(v); }
+static inline float v_hsum(vfloat v) { return vaddvq_f32(v); }
+static inline vfloat v_pow2n(vfloat y, vfloat n)
+{
+    int32x4_t e = vshlq_n_s32(vcvtnq_s32_f32(n), 23);
+    return vreinterpretq_f32_s32(vaddq_s32(vreinterpretq_s32_f32(y), e));
+}
+static inline vfloat v_round(vfloat x) { return vrndnq_f32(x); }
+static inline vfloat v_select_gt(vfloat a, vfloat b, vfloat x, vfloat y) { return vbslq_f32(vcgtq_f32(a, b), x, y); }
+#elif defined(__AVX2__) && defined(__FMA__)
+#define SOFTMAX_LANES 8
+typedef __m256 vfloat;
+static inline vfloat v_load(const float *p) { return _mm256_loadu_ps(p); }
+static inline void v_store(float *p, vfloat v) { _mm256_storeu_ps(p, v); }
+static inline vfloat v_set(float x) { return _mm256_set1_ps(x); }
+static inline vfloat v_add(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat v_sub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+static inline vfloat v_mul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat v_fma(vfloat a, vfloat b, vfloat c) { return _mm256_fmadd_ps(a, b, c); }
+static inline vfloat v_max(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat v_min(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline float v_hmax(vfloat v)
+{
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+static inline float v_hsum(vfloat v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+static inline vfloat v_pow2n(vfloat y, vfloat n)
+{
+    __m256i e = _mm256_slli_epi32(_mm256_cvtps_epi32(n), 23);
+    return _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(y), e));
+}
+static inline vfloat v_round(vfloat x) { return _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+static inline vfloat v_select_gt(vfloat a, vfloat b, vfloat x, vfloat y)
+{
+    return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_GT_OQ));
+}
+#elif defined(__SSE2__)
+#define SOFTMAX_LANES 4
+typedef __m128 vfloat;
+static inline vfloat v_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void v_store(float *p, vfloat v) { _mm_storeu_ps(p, v); }
+static inline vfloat v_set(float x) { return _mm_set1_ps(x); }
+static inline vfloat v_add(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat v_sub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat v_mul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat v_fma(vfloat a, vfloat b, vfloat c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+static inline vfloat v_max(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat v_min(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline float v_hmax(vfloat v)
+{
+    vfloat m = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+static inline float v_hsum(vfloat v)
+{
+    vfloat s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+static inline vfloat v_pow2n(vfloat y, vfloat n)
+{
+    __m128i e = _mm_slli_epi32(_mm_cvtps_epi32(n), 23);
+    return _mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(y), e));
+}
+// n 的绝对值远小于 2^22, 可用加减魔数取整 (当前舍入模式为就近偶数)
+static inline vfloat v_round(vfloat x)
+{
+    const vfloat magic = _mm_set1_ps(12582912.f);
+    return _mm_sub_ps(_mm_add_ps(x, magic), magic);
+}
+static inline vfloat v_select_gt(vfloat a, vfloat b, vfloat x, vfloat y)
+{
+    vfloat gt = _mm_cmpgt_ps(a, b);
+    return _mm_or_ps(_mm_and_ps(gt, x), _mm_andnot_ps(gt, y));
+}
+#endif
+
+#ifdef SOFTMAX_LANES
+static inline vfloat v_exp(vfloat x)
+{
+    x = v_min(v_max(x, v_set(EXP_LO)), v_set(EXP_HI));
+    vfloat n = v_round(v_mul(x, v_set(LOG2E)));
+    vfloat r = v_sub(v_sub(x, v_mul(n, v_set(LN2_HI))), v_mul(n, v_set(LN2_LO)));
+    vfloat y = v_set(EXP_P0);
+    y = v_fma(y, r, v_set(EXP_P1));
+    y = v_fma(y, r, v_set(EXP_P2));
+    y = v_fma(y, r, v_set(EXP_P3));
+    y = v_fma(y, r, v_set(EXP_P4));
+    y = v_fma(y, r, v_set(EXP_P5));
+    y = v_add(v_fma(v_mul(y, r), r, r), v_set(1.f));
+    return v_pow2n(y, n);
+}
+#endif
+
+static float block_max(const float *in, int n)
+{
+    int i = 0;
+    float m = -INFINITY;
+#ifdef SOFTMAX_LANES
+    if (n >= SOFTMAX_LANES)
+    {
+        vfloat vm = v_load(in);
+        for (i = SOFTMAX_LANES; i + SOFTMAX_LANES <= n; i += SOFTMAX_LANES)
+        {
+            vm = v_max(vm, v_load(in + i));
+        }
+        m = v_hmax(vm);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        m = std::max(m, in[i]);
+    }
+    return m;
+}
+
+// 返回 sum(exp(in - m)), out 非空时同时写出 exp 值
+static float block_exp_sum(const float *in, float *out, int n, float m)
+{
+    int i = 0;
+    float sum = 0.f;
+#ifdef SOFTMAX_LANES
+    vfloat vm = v_set(m);
+    vfloat vs = v_set(0.f);
+    for (; i + SOFTMAX_LANES <= n; i += SOFTMAX_LANES)
+    {
+        vfloat e = v_exp(v_sub(v_load(in + i), vm));
+        if (out) v_store(out + i, e);
+        vs = v_add(vs, e);
+    }
+    // 尾部补到整向量, 补位取 m - 80, exp 约 2e-35, 不影响求和
+    if (i < n)
+    {
+        float tmp[SOFTMAX_LANES];
+        for (int k = 0; k < SOFTMAX_LANES; k++) tmp[k] = i + k < n ? in[i + k] : m - 80.f;
+        vfloat e = v_exp(v_sub(v_load(tmp), vm));
+        v_store(tmp, e);
+        for (int k = 0; i < n; k++, i++)
+        {
+            if (out) out[i] = tmp[k];
+            sum += tmp[k];
+        }
+    }
+    sum += v_hsum(vs);
+#endif
+    for (; i < n; i++)
+    {
+        float e = exp_poly(in[i] - m);
+        if (out) out[i] = e;
+        sum += e;
+    }
+    return sum;
+}
+
+static void scale_range(float *p, int n, float s)
+{
+    int i = 0;
+#ifdef SOFTMAX_LANES
+    vfloat vs = v_set(s);
+    for (; i + SOFTMAX_LANES <= n; i += SOFTMAX_LANES)
+    {
+        v_store(p + i, v_mul(v_load(p + i), vs));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        p[i] *= s;
+    }
+}
+
+// 单趟求行最大值与 exp 和. out 非空时写出 exp 值, segments 记录每段写出时所用的最大值
+struct ExpSegments
+{
+    int start[SOFTMAX_MAX_SEGMENTS];
+    float max[SOFTMAX_MAX_SEGMENTS];
+    int count = 0;
+};
+
+static float fused_max_exp_sum(const float *in, float *out, int cols, float &m, ExpSegments *segments)
+{
+    float sum = 0.f;
+    m = -INFINITY;
+    for (int i = 0; i < cols; i += SOFTMAX_BLOCK)
+    {
+        int n = std::min(SOFTMAX_BLOCK, cols - i);
+        float bm = block_max(in + i, n);
+        if (bm > m)
+        {
+            if (i > 0) sum *= exp_poly(m - bm);
+            m = bm;
+            if (segments)
+            {
+                if (segments->count == SOFTMAX_MAX_SEGMENTS)
+                {
+                    // 分段表满: 把已写出的部分统一换算到新的最大值, 合并成一段
+                    for (int k = 0; k < segments->count; k++)
+                    {
+                        int end = k + 1 < segments->count ? segments->start[k + 1] : i;
+                        scale_range(out + segments->start[k], end - segments->start[k], exp_poly(segments->max[k] - m));
+                    }
+                    segments->count = 1;
+                    segments->start[0] = 0;
+                    segments->max[0] = m;
+                }
+                else
+                {
+                    segments->start[segments->count] = i;
+                    segments->max[segments->count] = m;
+                    segments->count++;
+                }
+            }
+        }
+        sum += block_exp_sum(in + i, out ? out + i : nullptr, n, m);
+    }
+    return sum;
+}
+
+// 单个窄行的标量路径: 各元素的 exp 互不依赖, 可被乱序执行重叠, 单行时比补齐成向量的延迟更低
+static void narrow_row(const float *x, float *y, int cols, bool log_out)
+{
+    float m = x[0];
+    for (int i = 1; i < cols; i++) m = std::max(m, x[i]);
+    float e[SOFTMAX_NARROW];
+    float sum = 0.f;
+    for (int i = 0; i < cols; i++)
+    {
+        e[i] = exp_poly(x[i] - m);
+        sum += e[i];
+    }
+    if (log_out)
+    {
+        float shift = m + logf(sum);
+        for (int i = 0; i < cols; i++) y[i] = x[i] - shift;
+    }
+    else
+    {
+        float inv = 1.f / sum;
+        for (int i = 0; i < cols; i++) y[i] = e[i] * inv;
+    }
+}
+
+// 窄行批量: 每次取 SOFTMAX_LANES 行转置, 一个向量 lane 对应一行, 列方向逐个向量计算
+static int narrow_rows(const float *in, float *out, int rows, int cols, bool log_out)
+{
+    int r = 0;
+#ifdef SOFTMAX_LANES
+    float t[SOFTMAX_NARROW][SOFTMAX_LANES];
+    for (; r + SOFTMAX_LANES <= rows; r += SOFTMAX_LANES)
+    {
+        const float *x = in + (size_t)r * cols;
+        for (int k = 0; k < SOFTMAX_LANES; k++)
+            for (int j = 0; j < cols; j++) t[j][k] = x[k * cols + j];
+
+        vfloat m = v_load(t[0]);
+        for (int j = 1; j < cols; j++) m = v_max(m, v_load(t[j]));
+        vfloat sum = v_set(0.f);
+        vfloat e[SOFTMAX_NARROW];
+        for (int j = 0; j < cols; j++)
+        {
+            e[j] = v_exp(v_sub(v_load(t[j]), m));
+            sum = v_add(sum, e[j]);
+        }
+        if (log_out)
+        {
+            float s[SOFTMAX_LANES], mm[SOFTMAX_LANES];
+            v_store(s, sum);
+            v_store(mm, m);
+            for (int k = 0; k < SOFTMAX_LANES; k++) s[k] = mm[k] + logf(s[k]);
+            vfloat shift = v_load(s);
+            for (int j = 0; j < cols; j++) v_store(t[j], v_sub(v_load(t[j]), shift));
+        }
+        else
+        {
+            vfloat inv = v_set(1.f);
+            float s[SOFTMAX_LANES];
+            v_store(s, sum);
+            for (int k = 0; k < SOFTMAX_LANES; k++) s[k] = 1.f / s[k];
+            inv = v_load(s);
+            for (int j = 0; j < cols; j++) v_store(t[j], v_mul(e[j], inv));
+        }
+
+        float *y = out + (size_t)r * cols;
+        for (int k = 0; k < SOFTMAX_LANES; k++)
+            for (int j = 0; j < cols; j++) y[k * cols + j] = t[j][k];
+    }
+#endif
+    for (; r < rows; r++)
+    {
+        narrow_row(in + (size_t)r * cols, out + (size_t)r * cols, cols, log_out);
+    }
+    return rows;
+}
+
+void softmax_rows(const float *in, float *out, int rows, int cols)
+{
+    if (cols <= 0) return;
+    if (cols <= SOFTMAX_NARROW)
+    {
+        narrow_rows(in, out, rows, cols, false);
+        return;
+    }
+    for (int r = 0; r < rows; r++)
+    {
+        const float *x = in + (size_t)r * cols;
+        float *y = out + (size_t)r * cols;
+        ExpSegments segments;
+        float m;
+        float inv = 1.f / fused_max_exp_sum(x, y, cols, m, &segments);
+        for (int k = 0; k < segments.count; k++)
+        {
+            int end = k + 1 < segments.count ? segments.start[k + 1] : cols;
+            float s = segments.max[k] == m ? inv : exp_poly(segments.max[k] - m) * inv;
+            scale_range(y + segments.start[k], end - segments.start[k], s);
+        }
+    }
+}
+
+void log_softmax_rows(const float *in, float *out, int rows, int cols)
+{
+    if (cols <= 0) return;
+    if (cols <= SOFTMAX_NARROW)
+    {
+        narrow_rows(in, out, rows, cols, true);
+        return;
+    }
+    for (int r = 0; r < rows; r++)
+    {
+        const float *x = in + (size_t)r * cols;
+        float *y = out + (size_t)r * cols;
+        float m;
+        float shift = logf(fused_max_exp_sum(x, nullptr, cols, m, nullptr));
+        shift += m;
+        int i = 0;
+#ifdef SOFTMAX_LANES
+        vfloat vs = v_set(shift);
+        for (; i + SOFTMAX_LANES <= cols; i += SOFTMAX_LANES)
+        {
+            v_store(y + i, v_sub(v_load(x + i), vs));
+        }
+#endif
+        for (; i < cols; i++)
+        {
+            y[i] = x[i] - shift;
+        }
+    }
+}
+
+void softmax_argmax_rows(const float *in, int rows, int cols, int *cls, float *score)
+{
+    if (cols <= 0) return;
+    int r = 0;
+#ifdef SOFTMAX_LANES
+    // 窄行: 与 narrow_rows 相同的转置, lane 对应批内的一行, 比较和求和都沿批方向进行
+    if (cols <= SOFTMAX_NARROW)
+    {
+        float t[SOFTMAX_NARROW][SOFTMAX_LANES];
+        for (; r + SOFTMAX_LANES <= rows; r += SOFTMAX_LANES)
+        {
+            const float *x = in + (size_t)r * cols;
+            for (int k = 0; k < SOFTMAX_LANES; k++)
+                for (int j = 0; j < cols; j++) t[j][k] = x[k * cols + j];
+
+            vfloat m = v_load(t[0]);
+            vfloat idx = v_set(0.f);
+            for (int j = 1; j < cols; j++)
+            {
+                vfloat v = v_load(t[j]);
+                idx = v_select_gt(v, m, v_set((float)j), idx);
+                m = v_max(m, v);
+            }
+            vfloat sum = v_set(0.f);
+            for (int j = 0; j < cols; j++)
+            {
+                sum = v_add(sum, v_exp(v_sub(v_load(t[j]), m)));
+            }
+            float id[SOFTMAX_LANES], s[SOFTMAX_LANES];
+            v_store(id, idx);
+            v_store(s, sum);
+            for (int k = 0; k < SOFTMAX_LANES; k++)
+            {
+                cls[r + k] = (int)id[k];
+                score[r + k] = 1.f / s[k];
+            }
+        }
+    }
+#endif
+    for (; r < rows; r++)
+    {
+        const float *x = in + (size_t)r * cols;
+        float m;
+        float sum;
+        if (cols <= SOFTMAX_NARROW)
+        {
+            m = x[0];
+            for (int j = 1; j < cols; j++) m = std::max(m, x[j]);
+            sum = 0.f;
+            for (int j = 0; j < cols; j++) sum += exp_poly(x[j] - m);
+        }
+        else
+        {
+            sum = fused_max_exp_sum(x, nullptr, cols, m, nullptr);
+        }
+        cls[r] = argmax(x, cols);
+        score[r] = 1.f / sum;
+    }
+}
+
+void softmax_reference(float *array, int size)
+{
+    float max_val = array[0];
+    for (int i = 1; i < size; i++)
+    {
+        if (array[i] > max_val)
+        {
+            max_val = array[i];
+        }
+    }
+    for (int i = 0; i < size; i++)
+    {
+        array[i] -= max_val;
+    }
+    float sum = 0.0;
+    for (int i = 0; i < size; i++)
+    {
+        array[i] = expf(array[i]);
+        sum += array[i];
+    }
+    for (int i = 0; i < size; i++)
+    {
+        array[i] /= sum;
+    }
+}
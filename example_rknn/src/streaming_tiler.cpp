@@ -0,0 +1,76 @@
+#include "streaming_tiler.hpp"
+#include <string.h>
+#include <algorithm>
+
+int MatRowSource::read_rows(uint8_t *dst, size_t stride, int max_rows)
+{
+    int n = std::min(max_rows, image_.rows - next_row_);
+    size_t bytes = (size_t)image_.cols * 3;
+    for (int r = 0; r < n; r++) {
+        memcpy(dst + r * stride, image_.ptr<uint8_t>(next_row_ + r), bytes);
+    }
+    next_row_ += n;
+    return n;
+}
+
+RawRowSource::RawRowSource(const std::string &path, int width, int height)
+    : width_(width), height_(height)
+{
+    fp_ = fopen(path.c_str(), "rb");
+    if (fp_ == nullptr) {
+        printf("Open file %s failed.\n", path.c_str());
+    }
+}
+
+RawRowSource::~RawRowSource()
+{
+    if (fp_ != nullptr) {
+        fclose(fp_);
+        fp_ = nullptr;
+    }
+}
+
+int RawRowSource::read_rows(uint8_t *dst, size_t stride, int max_rows)
+{
+    if (fp_ == nullptr) return 0;
+
+    int n = std::min(max_rows, height_ - next_row_);
+    size_t bytes = (size_t)width_ * 3;
+    int r = 0;
+    for (; r < n; r++) {
+        if (fread(dst + r * stride, 1, bytes, fp_) != bytes) break;
+    }
+    next_row_ += r;
+    return r;
+}
+
+StreamingTiler::StreamingTiler(RowSource &source, const TilingSpec &spec) : source_(source)
+{
+    if (source.width() <= 0 || source.height() <= 0) return;
+
+    frame_.create(source.height(), source.width(), CV_8UC3);
+    layout_ = spec.resolve(source.width(), source.height());
+}
+
+bool StreamingTiler::next_band(std::vector<resnet_input> &out)
+{
+    if (frame_.empty() || band_ >= layout_.rows) {
+        return false;
+    }
+
+    // 读满当前行带, 数据源可能一次只给出部分行; Pad 布局的末行带止于图像底边
+    int band_end = std::min(layout_.ys[band_] + layout_.tile_h, frame_.rows);
+    while (rows_read_ < band_end) {
+        int n = source_.read_rows(frame_.ptr<uint8_t>(rows_read_), frame_.step, band_end - rows_read_);
+        if (n <= 0) {
+            return false;
+        }
+        rows_read_ += n;
+    }
+
+    for (int j = 0; j < layout_.cols; ++j) {
+        out.push_back(resnet_input(crop_tile(frame_, layout_, band_, j), layout_.id(band_, j)));
+    }
+    band_++;
+    return true;
+}
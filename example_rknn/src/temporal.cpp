@@ -0,0 +1,71 @@
+#include "temporal.hpp"
+#include <stdlib.h>
+#include <algorithm>
+
+TileChangeDetector::TileChangeDetector(const TemporalParams &params) : params_(params)
+{
+    params_.downsample = std::min(std::max(params_.downsample, 1), 8);
+}
+
+void TileChangeDetector::reset(int tiles)
+{
+    ref_.assign(tiles, std::vector<uint8_t>());
+    cur_.assign(tiles, std::vector<uint8_t>());
+}
+
+// 按 ds x ds 像素块逐通道求均值. 不合并通道, 亮度相近的色相变化同样能检出
+static void make_thumbnail(const cv::Mat &tile, int ds, std::vector<uint8_t> &thumb)
+{
+    int ch = tile.channels();
+    int tw = (tile.cols + ds - 1) / ds;
+    int th = (tile.rows + ds - 1) / ds;
+    thumb.resize((size_t)tw * th * ch);
+
+    std::vector<uint32_t> acc((size_t)tw * ch);
+    for (int by = 0; by < th; by++) {
+        std::fill(acc.begin(), acc.end(), 0);
+        int y0 = by * ds, y1 = std::min(y0 + ds, tile.rows);
+        for (int y = y0; y < y1; y++) {
+            const uint8_t *p = tile.ptr<uint8_t>(y);
+            for (int x = 0; x < tile.cols; x++) {
+                uint32_t *a = &acc[(x / ds) * ch];
+                for (int c = 0; c < ch; c++) a[c] += p[x * ch + c];
+            }
+        }
+        uint8_t *row = &thumb[(size_t)by * tw * ch];
+        for (int bx = 0; bx < tw; bx++) {
+            uint32_t count = (uint32_t)std::min(ds, tile.cols - bx * ds) * (y1 - y0);
+            for (int c = 0; c < ch; c++) row[bx * ch + c] = (uint8_t)(acc[bx * ch + c] / count);
+        }
+    }
+}
+
+bool TileChangeDetector::changed(int id, const cv::Mat &tile)
+{
+    if (id < 0 || id >= (int)cur_.size() || tile.empty() || tile.depth() != CV_8U) {
+        return true;
+    }
+
+    std::vector<uint8_t> &cur = cur_[id];
+    const std::vector<uint8_t> &ref = ref_[id];
+    make_thumbnail(tile, params_.downsample, cur);
+    if (ref.size() != cur.size()) {
+        return true;
+    }
+
+    uint32_t sad = 0;
+    int peak = 0;
+    for (size_t i = 0; i < cur.size(); i++) {
+        int d = abs((int)cur[i] - (int)ref[i]);
+        sad += d;
+        peak = std::max(peak, d);
+    }
+    return peak > params_.peak_threshold || sad > params_.mean_threshold * cur.size();
+}
+
+void TileChangeDetector::commit(int id)
+{
+    if (id >= 0 && id < (int)cur_.size()) {
+        ref_[id].swap(cur_[id]);
+    }
+}
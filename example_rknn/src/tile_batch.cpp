@@ -0,0 +1,82 @@
+#include "tile_batch.hpp"
+#include <string.h>
+#include <algorithm>
+
+TileBatchPool::State::~State()
+{
+    for (auto *batch : free_list) {
+        delete batch;
+    }
+}
+
+void TileBatchPool::Releaser::operator()(TileBatch *batch) const
+{
+    if (batch == nullptr) return;
+    {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        if (state->free_list.size() < state->max_cached) {
+            state->free_list.push_back(batch);
+            return;
+        }
+    }
+    delete batch;
+}
+
+TileBatchPool::TileBatchPool(size_t max_cached) : state_(std::make_shared<State>())
+{
+    state_->max_cached = max_cached;
+    state_->free_list.reserve(max_cached);
+}
+
+TileBatchPool::Handle TileBatchPool::acquire()
+{
+    TileBatch *batch = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        if (!state_->free_list.empty()) {
+            batch = state_->free_list.back();
+            state_->free_list.pop_back();
+        }
+    }
+    if (batch == nullptr) {
+        batch = new TileBatch();
+    }
+    return Handle(batch, Releaser{state_});
+}
+
+int pack_tile_batch(const std::vector<resnet_input> &tiles, size_t first, int n,
+                    int tile_w, int tile_h, TileBatch &batch)
+{
+    if (first >= tiles.size() || n <= 0 || tile_w <= 0 || tile_h <= 0) {
+        batch.n = 0;
+        return 0;
+    }
+    n = (int)std::min<size_t>(n, tiles.size() - first);
+
+    batch.n = n;
+    batch.h = tile_h;
+    batch.w = tile_w;
+    batch.c = 3;
+    batch.data.resize((size_t)n * batch.tile_bytes());
+    batch.ids.resize(n);
+
+    const size_t dst_row = (size_t)tile_w * batch.c;
+    for (int i = 0; i < n; i++) {
+        const cv::Mat &img = tiles[first + i].img;
+        batch.ids[i] = tiles[first + i].id;
+        // 空图或尺寸不足的边缘 tile, 先整体清零再拷贝有效区域
+        if (img.empty() || img.type() != CV_8UC3 || img.cols < tile_w || img.rows < tile_h) {
+            memset(batch.tile(i), 0, batch.tile_bytes());
+        }
+    }
+
+    for (int r = 0; r < tile_h; r++) {
+        for (int i = 0; i < n; i++) {
+            const cv::Mat &img = tiles[first + i].img;
+            if (img.empty() || img.type() != CV_8UC3 || r >= img.rows) continue;
+            size_t bytes = std::min<size_t>(img.cols, tile_w) * batch.c;
+            memcpy(batch.tile(i) + r * dst_row, img.ptr<uint8_t>(r), bytes);
+        }
+    }
+    return n;
+}
@@ -0,0 +1,200 @@
+#include "tile_filter.hpp"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+float TileMoments::max_stddev() const
+{
+    return sqrtf(std::max(var[0], std::max(var[1], var[2])));
+}
+
+// 各通道的和与平方和. 向量累加器跨行保持, 整个 tile 结束后才归约一次;
+// 行首总是像素边界, 所以标量尾部的字节下标 % 3 就是通道号
+struct MomentAccumulator
+{
+    uint64_t sum[3] = {0, 0, 0};
+    uint64_t sq[3] = {0, 0, 0};
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint32x4_t s32[3], q32[3];
+    MomentAccumulator()
+    {
+        for (int c = 0; c < 3; c++) s32[c] = q32[c] = vdupq_n_u32(0);
+    }
+    void reduce()
+    {
+        for (int c = 0; c < 3; c++) {
+            sum[c] += vaddvq_u32(s32[c]);
+            sq[c] += vaddvq_u32(q32[c]);
+            s32[c] = q32[c] = vdupq_n_u32(0);
+        }
+    }
+#elif defined(__SSE2__)
+    // 以 48 字节为周期, 第 j 个 16 字节块的第 l 个字节属于通道 (16 * j + l) % 3
+    __m128i s32[3][4], q32[3][4];
+    MomentAccumulator()
+    {
+        for (int j = 0; j < 3; j++)
+            for (int k = 0; k < 4; k++) s32[j][k] = q32[j][k] = _mm_setzero_si128();
+    }
+    void reduce()
+    {
+        for (int j = 0; j < 3; j++) {
+            for (int k = 0; k < 4; k++) {
+                uint32_t s[4], q[4];
+                _mm_storeu_si128((__m128i *)s, s32[j][k]);
+                _mm_storeu_si128((__m128i *)q, q32[j][k]);
+                for (int l = 0; l < 4; l++) {
+                    int c = (16 * j + 4 * k + l) % 3;
+                    sum[c] += s[l];
+                    sq[c] += q[l];
+                }
+                s32[j][k] = q32[j][k] = _mm_setzero_si128();
+            }
+        }
+    }
+#else
+    void reduce() {}
+#endif
+};
+
+#if defined(__SSE2__) && !(defined(__ARM_NEON) || defined(__ARM_NEON__))
+static inline void accumulate_block(MomentAccumulator &acc, int j, __m128i v)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i w[2] = {_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)};
+    for (int h = 0; h < 2; h++) {
+        __m128i x2 = _mm_mullo_epi16(w[h], w[h]);
+        acc.s32[j][2 * h] = _mm_add_epi32(acc.s32[j][2 * h], _mm_unpacklo_epi16(w[h], zero));
+        acc.s32[j][2 * h + 1] = _mm_add_epi32(acc.s32[j][2 * h + 1], _mm_unpackhi_epi16(w[h], zero));
+        acc.q32[j][2 * h] = _mm_add_epi32(acc.q32[j][2 * h], _mm_unpacklo_epi16(x2, zero));
+        acc.q32[j][2 * h + 1] = _mm_add_epi32(acc.q32[j][2 * h + 1], _mm_unpackhi_epi16(x2, zero));
+    }
+}
+#endif
+
+// 返回本行进入向量累加器的块数, 供调用方判断何时归约以防 32 位溢出
+static int accumulate_row(const uint8_t *p, int bytes, MomentAccumulator &acc)
+{
+    int i = 0, blocks = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; i + 48 <= bytes; i += 48, blocks++) {
+        uint8x16x3_t v = vld3q_u8(p + i);
+        for (int c = 0; c < 3; c++) {
+            acc.s32[c] = vpadalq_u16(acc.s32[c], vpaddlq_u8(v.val[c]));
+            uint16x8_t lo = vmull_u8(vget_low_u8(v.val[c]), vget_low_u8(v.val[c]));
+            uint16x8_t hi = vmull_u8(vget_high_u8(v.val[c]), vget_high_u8(v.val[c]));
+            acc.q32[c] = vpadalq_u16(vpadalq_u16(acc.q32[c], lo), hi);
+        }
+    }
+    if (i + 24 <= bytes) {
+        uint8x8x3_t v = vld3_u8(p + i);
+        for (int c = 0; c < 3; c++) {
+            acc.s32[c] = vpadalq_u16(acc.s32[c], vmovl_u8(v.val[c]));
+            acc.q32[c] = vpadalq_u16(acc.q32[c], vmull_u8(v.val[c], v.val[c]));
+        }
+        i += 24;
+        blocks++;
+    }
+#elif defined(__SSE2__)
+    // 不足 48 字节的尾部仍按 16 字节块累加, 块号决定所属周期位置
+    for (int j = 0; i + 16 <= bytes; i += 16, j = j == 2 ? 0 : j + 1, blocks++) {
+        accumulate_block(acc, j, _mm_loadu_si128((const __m128i *)(p + i)));
+    }
+#endif
+    for (; i < bytes; i++) {
+        int c = i % 3;
+        acc.sum[c] += p[i];
+        acc.sq[c] += (uint32_t)p[i] * p[i];
+    }
+    return blocks;
+}
+
+bool compute_tile_moments(const cv::Mat &tile, TileMoments &moments)
+{
+    if (tile.empty() || tile.type() != CV_8UC3) {
+        return false;
+    }
+
+    // 每块向每个 32 位 lane 至多加 4 * 255^2, 累计 4096 块后归约一次
+    MomentAccumulator acc;
+    int blocks = 0;
+    for (int y = 0; y < tile.rows; y++) {
+        blocks += accumulate_row(tile.ptr<uint8_t>(y), tile.cols * 3, acc);
+        if (blocks >= 4096) {
+            acc.reduce();
+            blocks = 0;
+        }
+    }
+    acc.reduce();
+
+    double n = (double)tile.rows * tile.cols;
+    for (int c = 0; c < 3; c++) {
+        double mean = acc.sum[c] / n;
+        moments.mean[c] = (float)mean;
+        moments.var[c] = (float)std::max(0.0, acc.sq[c] / n - mean * mean);
+    }
+    return true;
+}
+
+TileFilter::TileFilter(const TileFilterParams &params) : params_(params)
+{
+    reset_stats();
+}
+
+bool TileFilter::classify(const resnet_input &input, resnet_results &result)
+{
+    if (!params_.enabled) {
+        return false;
+    }
+
+    checked_.fetch_add(1, std::memory_order_relaxed);
+    bool blank = input.img.empty();
+    bool white = false;
+    if (!blank) {
+        TileMoments moments;
+        if (!compute_tile_moments(input.img, moments)) {
+            return false;
+        }
+        float stddev = moments.max_stddev();
+        int bin = std::min((int)stddev, TileFilterStats::HIST_BINS - 1);
+        hist_[bin].fetch_add(1, std::memory_order_relaxed);
+        blank = stddev <= params_.max_stddev;
+        white = std::min(moments.mean[0], std::min(moments.mean[1], moments.mean[2])) >= params_.min_white_mean;
+    }
+    if (!blank) {
+        return false;
+    }
+
+    skipped_.fetch_add(1, std::memory_order_relaxed);
+    memset(&result, 0, sizeof(result));
+    result.id = input.id;
+    result.result[0].cls = white ? params_.blank_class : params_.other_class;
+    result.result[0].score = params_.blank_score;
+    return true;
+}
+
+TileFilterStats TileFilter::stats() const
+{
+    TileFilterStats stats;
+    stats.checked = checked_.load(std::memory_order_relaxed);
+    stats.skipped = skipped_.load(std::memory_order_relaxed);
+    for (int i = 0; i < TileFilterStats::HIST_BINS; i++) {
+        stats.hist[i] = hist_[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+void TileFilter::reset_stats()
+{
+    checked_ = 0;
+    skipped_ = 0;
+    for (auto &bin : hist_) {
+        bin = 0;
+    }
+}
@@ -0,0 +1,164 @@
+#include "tiled_source.hpp"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+MappedRawSource::MappedRawSource(const std::string &path, int width, int height, Layout layout, bool planar_rgb)
+    : width_(width), height_(height), layout_(layout), planar_rgb_(planar_rgb)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        printf("Open file %s failed.\n", path.c_str());
+        return;
+    }
+
+    struct stat st;
+    size_t expected = (size_t)width * height * 3;
+    if (width <= 0 || height <= 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < expected) {
+        printf("File %s is smaller than %dx%dx3.\n", path.c_str(), width, height);
+        close(fd);
+        return;
+    }
+
+    void *addr = mmap(nullptr, expected, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        printf("mmap %s failed.\n", path.c_str());
+        return;
+    }
+    data_ = (uint8_t *)addr;
+    size_ = expected;
+    madvise(data_, size_, MADV_SEQUENTIAL);
+}
+
+MappedRawSource::~MappedRawSource()
+{
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+        data_ = nullptr;
+    }
+}
+
+cv::Mat MappedRawSource::read(const cv::Rect &rect)
+{
+    if (data_ == nullptr) return cv::Mat();
+
+    if (layout_ == Layout::Interleaved) {
+        size_t step = (size_t)width_ * 3;
+        return cv::Mat(rect.height, rect.width, CV_8UC3, data_ + rect.y * step + rect.x * 3, step);
+    }
+
+    // 平面 -> BGR 交织
+    size_t plane = (size_t)width_ * height_;
+    const uint8_t *b = data_ + (planar_rgb_ ? 2 : 0) * plane;
+    const uint8_t *g = data_ + plane;
+    const uint8_t *r = data_ + (planar_rgb_ ? 0 : 2) * plane;
+    cv::Mat tile(rect.height, rect.width, CV_8UC3);
+    for (int y = 0; y < rect.height; y++) {
+        size_t offset = (size_t)(rect.y + y) * width_ + rect.x;
+        uint8_t *dst = tile.ptr<uint8_t>(y);
+        for (int x = 0; x < rect.width; x++) {
+            dst[x * 3] = b[offset + x];
+            dst[x * 3 + 1] = g[offset + x];
+            dst[x * 3 + 2] = r[offset + x];
+        }
+    }
+    return tile;
+}
+
+void MappedRawSource::advise_rows(int y0, int y1, int advice)
+{
+    y0 = std::max(y0, 0);
+    y1 = std::min(y1, height_);
+    if (data_ == nullptr || y0 >= y1) return;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t row_bytes = (size_t)width_ * (layout_ == Layout::Interleaved ? 3 : 1);
+    int planes = layout_ == Layout::Interleaved ? 1 : 3;
+    for (int p = 0; p < planes; p++) {
+        size_t base = p * row_bytes * height_;
+        size_t begin = base + y0 * row_bytes;
+        size_t end = base + y1 * row_bytes;
+        // 释放时只动完整落在区间内的页, 预取时向外扩到整页
+        if (advice == MADV_DONTNEED) {
+            begin = (begin + page - 1) / page * page;
+            end = end / page * page;
+        } else {
+            begin = begin / page * page;
+            end = std::min((end + page - 1) / page * page, size_);
+        }
+        if (begin < end) {
+            madvise(data_ + begin, end - begin, advice);
+        }
+    }
+}
+
+void MappedRawSource::prefetch_rows(int y0, int y1)
+{
+    advise_rows(y0, y1, MADV_WILLNEED);
+}
+
+void MappedRawSource::release_rows(int y)
+{
+    if (y <= released_) return;
+    advise_rows(released_, y, MADV_DONTNEED);
+    released_ = y;
+}
+
+BandBufferSource::BandBufferSource(RowSource &source) : source_(source) {}
+
+bool BandBufferSource::fill_to(int y)
+{
+    size_t bytes = (size_t)source_.width() * 3;
+    while (first_row_ + (int)rows_.size() < y) {
+        std::vector<uint8_t> row(bytes);
+        if (source_.read_rows(row.data(), bytes, 1) != 1) {
+            return false;
+        }
+        rows_.push_back(std::move(row));
+    }
+    peak_rows_ = std::max(peak_rows_, rows_.size());
+    return true;
+}
+
+cv::Mat BandBufferSource::read(const cv::Rect &rect)
+{
+    if (rect.y < first_row_ || !fill_to(rect.y + rect.height)) {
+        return cv::Mat();
+    }
+
+    cv::Mat tile(rect.height, rect.width, CV_8UC3);
+    for (int y = 0; y < rect.height; y++) {
+        memcpy(tile.ptr<uint8_t>(y), rows_[rect.y + y - first_row_].data() + rect.x * 3, (size_t)rect.width * 3);
+    }
+    return tile;
+}
+
+void BandBufferSource::release_rows(int y)
+{
+    while (first_row_ < y && !rows_.empty()) {
+        rows_.pop_front();
+        first_row_++;
+    }
+}
+
+cv::Mat read_tile(TiledSource &source, const TileLayout &layout, int row, int col)
+{
+    cv::Rect rect = layout.rect(row, col);
+    cv::Rect inside = rect & cv::Rect(0, 0, source.width(), source.height());
+    if (inside.width == rect.width && inside.height == rect.height) {
+        return source.read(rect);
+    }
+
+    cv::Mat tile = cv::Mat::zeros(rect.height, rect.width, CV_8UC3);
+    if (inside.area() > 0) {
+        cv::Mat part = source.read(inside);
+        if (!part.empty()) {
+            part.copyTo(tile(cv::Rect(inside.x - rect.x, inside.y - rect.y, inside.width, inside.height)));
+        }
+    }
+    return tile;
+}
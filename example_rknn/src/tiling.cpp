@@ -0,0 +1,132 @@
+#include "tiling.hpp"
+#include <algorithm>
+
+TilingSpec TilingSpec::grid(int rows, int cols, BorderPolicy border)
+{
+    TilingSpec spec;
+    spec.rows = rows;
+    spec.cols = cols;
+    spec.border = border;
+    return spec;
+}
+
+TilingSpec TilingSpec::window(int tile_w, int tile_h, int stride_x, int stride_y, BorderPolicy border)
+{
+    TilingSpec spec;
+    spec.tile_w = tile_w;
+    spec.tile_h = tile_h;
+    spec.stride_x = stride_x;
+    spec.stride_y = stride_y;
+    spec.border = border;
+    return spec;
+}
+
+// 网格模式下的单轴: count 份等分, 返回 tile 尺寸并填写起点
+static int resolve_grid_axis(int len, int count, BorderPolicy border, std::vector<int> &pos)
+{
+    pos.clear();
+    if (len <= 0 || count <= 0) return 0;
+
+    int tile = len / count;
+    if (tile == 0) {
+        // 图像比网格还小: 每个 tile 不足 1 像素, 补零只会得到 1 像素的 tile, 送进模型没有意义.
+        // 拒绝切分, 由调用方报错或改用尺寸模式
+        return 0;
+    }
+    if (border == BorderPolicy::Drop || len % count == 0) {
+        for (int i = 0; i < count; i++) pos.push_back(i * tile);
+        return tile;
+    }
+
+    // 有余数: tile 取上整, Pad 依次排开末块越界, Shift 把起点均匀分布在 [0, len - tile]
+    tile = (len + count - 1) / count;
+    for (int i = 0; i < count; i++) {
+        if (border == BorderPolicy::Pad || count == 1) {
+            pos.push_back(i * tile);
+        } else {
+            pos.push_back((int)((long long)i * (len - tile) / (count - 1)));
+        }
+    }
+    return tile;
+}
+
+// 尺寸模式下的单轴: 固定 tile 和步长滑窗
+static void resolve_window_axis(int len, int tile, int stride, BorderPolicy border, std::vector<int> &pos)
+{
+    pos.clear();
+    if (len <= 0 || tile <= 0) return;
+    if (stride <= 0) stride = tile;
+
+    if (len < tile) {
+        // 图像比窗口还小: 任何策略都补零出一个窗口, 不丢成 0 个
+        pos.push_back(0);
+        return;
+    }
+    int last = 0;
+    for (int p = 0; p + tile <= len; p += stride) {
+        pos.push_back(p);
+        last = p;
+    }
+    if (last + tile < len) {
+        if (border == BorderPolicy::Shift) {
+            pos.push_back(len - tile);
+        } else if (border == BorderPolicy::Pad) {
+            pos.push_back(last + stride);
+        }
+    }
+}
+
+TileLayout TilingSpec::resolve(int img_w, int img_h) const
+{
+    TileLayout layout;
+    layout.img_w = img_w;
+    layout.img_h = img_h;
+    layout.border = border;
+
+    if (tile_w > 0 && tile_h > 0) {
+        layout.tile_w = tile_w;
+        layout.tile_h = tile_h;
+        resolve_window_axis(img_w, tile_w, stride_x, border, layout.xs);
+        resolve_window_axis(img_h, tile_h, stride_y, border, layout.ys);
+    } else {
+        layout.tile_w = resolve_grid_axis(img_w, cols, border, layout.xs);
+        layout.tile_h = resolve_grid_axis(img_h, rows, border, layout.ys);
+    }
+    layout.cols = (int)layout.xs.size();
+    layout.rows = (int)layout.ys.size();
+    if (layout.tile_w == 0 || layout.tile_h == 0) {
+        layout.rows = layout.cols = 0;
+    }
+    // 任一 tile 越出图像时按补零处理, crop_tile 会拷贝
+    if (layout.rows > 0 && layout.cols > 0 &&
+        (layout.xs.back() + layout.tile_w > img_w || layout.ys.back() + layout.tile_h > img_h)) {
+        layout.border = BorderPolicy::Pad;
+    }
+    return layout;
+}
+
+bool TileLayout::uniform() const
+{
+    for (int j = 0; j < cols; j++) {
+        if (xs[j] != j * tile_w) return false;
+    }
+    for (int i = 0; i < rows; i++) {
+        if (ys[i] != i * tile_h) return false;
+    }
+    return cols * tile_w <= img_w && rows * tile_h <= img_h;
+}
+
+cv::Mat crop_tile(const cv::Mat &image, const TileLayout &layout, int row, int col)
+{
+    cv::Rect rect = layout.rect(row, col);
+    cv::Rect inside = rect & cv::Rect(0, 0, image.cols, image.rows);
+    if (inside.width == rect.width && inside.height == rect.height) {
+        return image(rect);
+    }
+
+    cv::Mat tile = cv::Mat::zeros(rect.height, rect.width, image.type());
+    if (inside.area() > 0) {
+        image(inside).copyTo(tile(cv::Rect(inside.x - rect.x, inside.y - rect.y, inside.width, inside.height)));
+    }
+    return tile;
+}
@@ -0,0 +1,343 @@
+#include "topk.h"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// 有序候选表的上限, 超过后改用 nth_element
+#define TOPK_SMALL 16
+
+static inline bool ranks_before(const element_t &a, const element_t &b)
+{
+    return a.value > b.value || (a.value == b.value && a.index < b.index);
+}
+
+int argmax(const float *row, int cols)
+{
+    if (cols <= 0) return -1;
+
+    int i = 0;
+    float best = row[0];
+    int best_idx = 0;
+    // 每个 lane 记录自己见到的最大值和首次出现的下标, 最后在 lane 之间取值最大, 同值取下标最小
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    if (cols >= 8)
+    {
+        float32x4_t vmax = vld1q_f32(row);
+        int32x4_t vidx = {0, 1, 2, 3};
+        int32x4_t cur = vidx;
+        const int32x4_t step = vdupq_n_s32(4);
+        for (i = 4; i + 4 <= cols; i += 4)
+        {
+            cur = vaddq_s32(cur, step);
+            float32x4_t v = vld1q_f32(row + i);
+            uint32x4_t gt = vcgtq_f32(v, vmax);
+            vmax = vbslq_f32(gt, v, vmax);
+            vidx = vbslq_s32(gt, cur, vidx);
+        }
+        float m[4];
+        int32_t id[4];
+        vst1q_f32(m, vmax);
+        vst1q_s32(id, vidx);
+        best = m[0];
+        best_idx = id[0];
+        for (int k = 1; k < 4; k++)
+        {
+            if (m[k] > best || (m[k] == best && id[k] < best_idx))
+            {
+                best = m[k];
+                best_idx = id[k];
+            }
+        }
+    }
+#elif defined(__AVX2__)
+    if (cols >= 16)
+    {
+        __m256 vmax = _mm256_loadu_ps(row);
+        __m256i vidx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i cur = vidx;
+        const __m256i step = _mm256_set1_epi32(8);
+        for (i = 8; i + 8 <= cols; i += 8)
+        {
+            cur = _mm256_add_epi32(cur, step);
+            __m256 v = _mm256_loadu_ps(row + i);
+            __m256 gt = _mm256_cmp_ps(v, vmax, _CMP_GT_OQ);
+            vmax = _mm256_blendv_ps(vmax, v, gt);
+            vidx = _mm256_blendv_epi8(vidx, cur, _mm256_castps_si256(gt));
+        }
+        float m[8];
+        int32_t id[8];
+        _mm256_storeu_ps(m, vmax);
+        _mm256_storeu_si256((__m256i *)id, vidx);
+        best = m[0];
+        best_idx = id[0];
+        for (int k = 1; k < 8; k++)
+        {
+            if (m[k] > best || (m[k] == best && id[k] < best_idx))
+            {
+                best = m[k];
+                best_idx = id[k];
+            }
+        }
+    }
+#elif defined(__SSE2__)
+    if (cols >= 8)
+    {
+        __m128 vmax = _mm_loadu_ps(row);
+        __m128i vidx = _mm_setr_epi32(0, 1, 2, 3);
+        __m128i cur = vidx;
+        const __m128i step = _mm_set1_epi32(4);
+        for (i = 4; i + 4 <= cols; i += 4)
+        {
+            cur = _mm_add_epi32(cur, step);
+            __m128 v = _mm_loadu_ps(row + i);
+            __m128 gt = _mm_cmpgt_ps(v, vmax);
+            __m128i gti = _mm_castps_si128(gt);
+            vmax = _mm_or_ps(_mm_and_ps(gt, v), _mm_andnot_ps(gt, vmax));
+            vidx = _mm_or_si128(_mm_and_si128(gti, cur), _mm_andnot_si128(gti, vidx));
+        }
+        float m[4];
+        int32_t id[4];
+        _mm_storeu_ps(m, vmax);
+        _mm_storeu_si128((__m128i *)id, vidx);
+        best = m[0];
+        best_idx = id[0];
+        for (int k = 1; k < 4; k++)
+        {
+            if (m[k] > best || (m[k] == best && id[k] < best_idx))
+            {
+                best = m[k];
+                best_idx = id[k];
+            }
+        }
+    }
+#endif
+    for (; i < cols; i++)
+    {
+        if (row[i] > best)
+        {
+            best = row[i];
+            best_idx = i;
+        }
+    }
+    return best_idx;
+}
+
+size_t topk_scratch_size(int cols, int k)
+{
+    return k > TOPK_SMALL ? (size_t)std::max(cols, 0) : 0;
+}
+
+// k 个元素的有序表, 末尾即当前门槛. 新元素不超过门槛时只比较一次
+static int topk_small(const float *row, int cols, int k, element_t *out)
+{
+    int n = 0;
+    for (int i = 0; i < cols; i++)
+    {
+        float v = row[i];
+        if (n == k && !(v > out[k - 1].value)) continue;
+
+        int pos = n < k ? n++ : k - 1;
+        while (pos > 0 && v > out[pos - 1].value)
+        {
+            out[pos] = out[pos - 1];
+            pos--;
+        }
+        out[pos].value = v;
+        out[pos].index = i;
+    }
+    return n;
+}
+
+int topk_row(const float *row, int cols, int k, element_t *out, element_t *scratch)
+{
+    k = std::min(k, cols);
+    if (k <= 0) return 0;
+
+    if (k == 1)
+    {
+        int idx = argmax(row, cols);
+        out[0].value = row[idx];
+        out[0].index = idx;
+        return 1;
+    }
+    if (k <= TOPK_SMALL || scratch == nullptr)
+    {
+        return topk_small(row, cols, k, out);
+    }
+
+    for (int i = 0; i < cols; i++)
+    {
+        scratch[i].value = row[i];
+        scratch[i].index = i;
+    }
+    std::nth_element(scratch, scratch + k - 1, scratch + cols, ranks_before);
+    std::sort(scratch, scratch + k, ranks_before);
+    std::copy(scratch, scratch + k, out);
+    return k;
+}
+
+void topk_rows(const float *in, int rows, int cols, int k, element_t *out, element_t *scratch)
+{
+    for (int r = 0; r < rows; r++)
+    {
+        topk_row(in + (size_t)r * cols, cols, k, out + (size_t)r * k, scratch);
+    }
+}
+
+// --- int8 量化输出 ---
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define I8_LANES 16
+typedef int8x16_t vi8;
+static inline vi8 i8_load(const int8_t *p) { return vld1q_s8(p); }
+static inline vi8 i8_set(int8_t x) { return vdupq_n_s8(x); }
+static inline vi8 i8_max(vi8 a, vi8 b) { return vmaxq_s8(a, b); }
+static inline int8_t i8_hmax(vi8 v) { return vmaxvq_s8(v); }
+// 与 x 相等的字节置为 -128, 其余不变; 返回是否有相等字节
+static inline vi8 i8_drop_eq(vi8 v, int8_t x, bool &any)
+{
+    uint8x16_t eq = vceqq_s8(v, vdupq_n_s8(x));
+    any = vmaxvq_u8(eq) != 0;
+    return vbslq_s8(eq, vdupq_n_s8(-128), v);
+}
+#elif defined(__AVX2__)
+#define I8_LANES 32
+typedef __m256i vi8;
+static inline vi8 i8_load(const int8_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline vi8 i8_set(int8_t x) { return _mm256_set1_epi8(x); }
+static inline vi8 i8_max(vi8 a, vi8 b) { return _mm256_max_epi8(a, b); }
+static inline int8_t i8_hmax(vi8 v)
+{
+    int8_t t[32];
+    _mm256_storeu_si256((__m256i *)t, v);
+    return *std::max_element(t, t + 32);
+}
+static inline vi8 i8_drop_eq(vi8 v, int8_t x, bool &any)
+{
+    __m256i eq = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(x));
+    any = _mm256_movemask_epi8(eq) != 0;
+    return _mm256_blendv_epi8(v, _mm256_set1_epi8(-128), eq);
+}
+#elif defined(__SSE2__)
+#define I8_LANES 16
+typedef __m128i vi8;
+static inline vi8 i8_load(const int8_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline vi8 i8_set(int8_t x) { return _mm_set1_epi8(x); }
+// SSE2 只有无符号字节 max, 翻转符号位后比较
+static inline vi8 i8_max(vi8 a, vi8 b)
+{
+    const __m128i sign = _mm_set1_epi8((char)0x80);
+    return _mm_xor_si128(_mm_max_epu8(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign)), sign);
+}
+static inline int8_t i8_hmax(vi8 v)
+{
+    int8_t t[16];
+    _mm_storeu_si128((__m128i *)t, v);
+    return *std::max_element(t, t + 16);
+}
+static inline vi8 i8_drop_eq(vi8 v, int8_t x, bool &any)
+{
+    __m128i eq = _mm_cmpeq_epi8(v, _mm_set1_epi8(x));
+    any = _mm_movemask_epi8(eq) != 0;
+    return _mm_or_si128(_mm_and_si128(eq, _mm_set1_epi8(-128)), _mm_andnot_si128(eq, v));
+}
+#endif
+
+ArgmaxI8 argmax_i8(const int8_t *row, int cols)
+{
+    ArgmaxI8 res = {-1, -128, -128};
+    if (cols <= 0) return res;
+
+    // 第一遍求最大值
+    int i = 0;
+    int8_t top = -128;
+#ifdef I8_LANES
+    if (cols >= I8_LANES)
+    {
+        vi8 vmax = i8_load(row);
+        for (i = I8_LANES; i + I8_LANES <= cols; i += I8_LANES)
+        {
+            vmax = i8_max(vmax, i8_load(row + i));
+        }
+        top = i8_hmax(vmax);
+    }
+#endif
+    for (; i < cols; i++)
+    {
+        top = std::max(top, row[i]);
+    }
+
+    // 第二遍: 最大值首次出现的位置, 以及去掉这一个之后的最大值 (并列第一时 margin 为 0)
+    i = 0;
+    int index = -1, ties = 0;
+    int8_t second = -128;
+#ifdef I8_LANES
+    if (cols >= I8_LANES)
+    {
+        vi8 vsecond = i8_set(-128);
+        for (; i + I8_LANES <= cols; i += I8_LANES)
+        {
+            bool any;
+            vi8 rest = i8_drop_eq(i8_load(row + i), top, any);
+            vsecond = i8_max(vsecond, rest);
+            if (any)
+            {
+                for (int k = 0; k < I8_LANES; k++)
+                {
+                    if (row[i + k] != top) continue;
+                    if (index < 0) index = i + k;
+                    ties++;
+                }
+            }
+        }
+        second = i8_hmax(vsecond);
+    }
+#endif
+    for (; i < cols; i++)
+    {
+        if (row[i] == top)
+        {
+            if (index < 0) index = i;
+            ties++;
+        }
+        else
+        {
+            second = std::max(second, row[i]);
+        }
+    }
+
+    res.index = index;
+    res.top = top;
+    res.second = ties > 1 ? top : second;
+    return res;
+}
+
+void build_exp_table_i8(float scale, float table[256])
+{
+    for (int d = 0; d < 256; d++)
+    {
+        table[d] = expf(-d * scale);
+    }
+}
+
+float winner_prob_i8(const int8_t *row, int cols, const ArgmaxI8 &best, const float table[256])
+{
+    if (cols <= 1) return 1.f;
+    // 其余各类都不比次大值高, 它们的贡献之和低于 float 精度时概率就是 1
+    if (table[best.top - best.second] * (cols - 1) < 6e-8f) return 1.f;
+
+    float sum = 0.f;
+    for (int j = 0; j < cols; j++)
+    {
+        sum += table[best.top - row[j]];
+    }
+    return 1.f / sum;
+}
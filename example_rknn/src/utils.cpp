@@ -3,16 +3,23 @@
 
 void dump_tensor_attr(rknn_tensor_attr *attr)
 {
-    std::string shape_str = attr->n_dims < 1 ? "" : std::to_string(attr->dims[0]);
-    for (int i = 1; i < attr->n_dims; ++i)
+    // 级别被过滤时不拼形状字符串
+    if (!ILOGGER_ENABLED(iLogger::LogLevel::Info))
     {
-        shape_str += ", " + std::to_string(attr->dims[i]);
+        return;
+    }
+
+    char shape_str[16 * RKNN_MAX_DIMS] = "";
+    int len = 0;
+    for (int i = 0; i < (int)attr->n_dims && len < (int)sizeof(shape_str); ++i)
+    {
+        len += snprintf(shape_str + len, sizeof(shape_str) - len, i == 0 ? "%d" : ", %d", attr->dims[i]);
     }
     
     INFO("  index=%d, name=%s, n_dims=%d, dims=[%s], n_elems=%d, size=%d, w_stride = %d, size_with_stride=%d, fmt=%s, "
         "type=%s, qnt_type=%s, "
         "zp=%d, scale=%f\n",
-        attr->index, attr->name, attr->n_dims, shape_str.c_str(), attr->n_elems, attr->size, attr->w_stride,
+        attr->index, attr->name, attr->n_dims, shape_str, attr->n_elems, attr->size, attr->w_stride,
         attr->size_with_stride, get_format_string(attr->fmt), get_type_string(attr->type),
         get_qnt_type_string(attr->qnt_type), attr->zp, attr->scale);
 }
@@ -89,38 +96,25 @@ std::vector<resnet_input> split_image(cv::Mat& image) {
         exit(1);  // 如果加载失败，退出程序
     }
 
-    int img_width = image.cols;
-    int img_height = image.rows;
-
-    // 计算每个小块的大小
-    int block_width = img_width / COLS;
-    int block_height = img_height / ROWS;
+    // 默认 ROWS x COLS 等分, 丢弃余数
+    return split_image(image, TilingSpec().resolve(image.cols, image.rows));
+}
 
+std::vector<resnet_input> split_image(const cv::Mat& image, const TileLayout& layout) {
     // 存储切割后的图块
     std::vector<resnet_input> inputs;
+    if (layout.count() == 0) {
+        std::cerr << "split_image: no tiles for " << image.cols << "x" << image.rows << " image" << std::endl;
+        return inputs;
+    }
+    inputs.reserve(layout.count());
 
-    // 按照行列顺序切割图像
-    for (int i = 0; i < ROWS; ++i) {
-        for (int j = 0; j < COLS; ++j) {
-            // 计算切割区域的坐标
-            int left = j * block_width;
-            int top = i * block_height;
-            int right = left + block_width;
-            int bottom = top + block_height;
-
-            // 确保切割区域不会超出原始图像边界
-            right = std::min(right, img_width);
-            bottom = std::min(bottom, img_height);
-
-            // 从原图中裁剪出小块
-            cv::Rect roi(left, top, right - left, bottom - top);
-            cv::Mat img_crop = image(roi);
-
-            // 将小块加入到返回值中
-            inputs.push_back(resnet_input(img_crop, i * COLS + j));
+    // 完全在图内的 tile 是父图 ROI, 越界 (Pad) 的才拷贝补零
+    for (int i = 0; i < layout.rows; ++i) {
+        for (int j = 0; j < layout.cols; ++j) {
+            inputs.push_back(resnet_input(crop_tile(image, layout, i, j), layout.id(i, j)));
         }
     }
-
     return inputs;
 }
 
@@ -0,0 +1,82 @@
+#include "window_fusion.hpp"
+#include <math.h>
+#include <algorithm>
+
+// 起点有序的单轴上与 [lo, hi) 相交的格子下标范围 [first, last): 起点 p 满足 p + tile > lo 且 p < hi
+static void overlap_range(const std::vector<int> &pos, int tile, int lo, int hi, int &first, int &last)
+{
+    first = (int)(std::upper_bound(pos.begin(), pos.end(), lo - tile) - pos.begin());
+    last = (int)(std::lower_bound(pos.begin(), pos.end(), hi) - pos.begin());
+}
+
+WindowFusion::WindowFusion(const TileLayout &windows, const TileLayout &cells, int num_classes)
+    : cells_(cells), num_classes_(num_classes)
+{
+    cover_begin_.reserve(windows.count() + 1);
+    for (int wr = 0; wr < windows.rows; wr++) {
+        for (int wc = 0; wc < windows.cols; wc++) {
+            cover_begin_.push_back((int)cover_.size());
+            cv::Rect win = windows.rect(wr, wc);
+            float half_w = win.width * 0.5f, half_h = win.height * 0.5f;
+            float cx = win.x + half_w, cy = win.y + half_h;
+
+            // 只遍历与窗口相交的行列, 构造开销与窗口数 x 每窗口覆盖格子数成正比
+            int r0, r1, c0, c1;
+            overlap_range(cells.ys, cells.tile_h, win.y, win.y + win.height, r0, r1);
+            overlap_range(cells.xs, cells.tile_w, win.x, win.x + win.width, c0, c1);
+            for (int r = r0; r < r1; r++) {
+                for (int c = c0; c < c1; c++) {
+                    cv::Rect cell = cells.rect(r, c);
+                    cv::Rect overlap = win & cell;
+                    if (overlap.area() <= 0) continue;
+
+                    // 中心衰减: 格子中心位于窗口中心时为 1, 位于窗口边缘时为 0.5
+                    float dx = fabsf(cell.x + cell.width * 0.5f - cx) / half_w;
+                    float dy = fabsf(cell.y + cell.height * 0.5f - cy) / half_h;
+                    float falloff = (1.f - 0.5f * std::min(dx, 1.f)) * (1.f - 0.5f * std::min(dy, 1.f));
+                    float weight = (float)overlap.area() / cell.area() * falloff;
+                    cover_.push_back(Cover{cells.id(r, c), weight});
+                }
+            }
+        }
+    }
+    cover_begin_.push_back((int)cover_.size());
+    votes_.assign((size_t)cells.count() * num_classes, 0.f);
+}
+
+void WindowFusion::reset()
+{
+    std::fill(votes_.begin(), votes_.end(), 0.f);
+    added_ = 0;
+}
+
+void WindowFusion::add(const resnet_results &result)
+{
+    int cls = result.result[0].cls;
+    if (result.id < 0 || result.id + 1 >= (int)cover_begin_.size() || cls < 0 || cls >= num_classes_) {
+        return;
+    }
+    float score = result.result[0].score;
+    for (int i = cover_begin_[result.id]; i < cover_begin_[result.id + 1]; i++) {
+        votes_[(size_t)cover_[i].cell * num_classes_ + cls] += cover_[i].weight * score;
+    }
+    added_++;
+}
+
+ClassMap WindowFusion::result() const
+{
+    ClassMap map(cells_.rows, cells_.cols);
+    for (int id = 0; id < cells_.count(); id++) {
+        const float *v = &votes_[(size_t)id * num_classes_];
+        int best = 0;
+        float total = v[0];
+        for (int k = 1; k < num_classes_; k++) {
+            total += v[k];
+            if (v[k] > v[best]) best = k;
+        }
+        if (total > 0.f) {
+            map.set(id, best, v[best] / total);
+        }
+    }
+    return map;
+}
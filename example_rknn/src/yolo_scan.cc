@@ -0,0 +1,175 @@
+#include "yolo_scan.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCAN_W 16
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define SCAN_W 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SCAN_W 16
+#else
+#define SCAN_W 16
+#endif
+
+// 一个向量块中 >= thres 的字节组成的位掩码, 第 l 位对应第 l 个字节
+static inline uint32_t ge_mask(const int8_t *p, int8_t thres)
+{
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint8x16_t ge = vcgeq_s8(vld1q_s8(p), vdupq_n_s8(thres));
+    // 每字节保留 1 位后两两折叠, 得到 16 位掩码
+    static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t m = vandq_u8(ge, vld1q_u8(bits));
+    uint8x8_t lo = vget_low_u8(m), hi = vget_high_u8(m);
+    return (uint32_t)vaddv_u8(lo) | ((uint32_t)vaddv_u8(hi) << 8);
+#elif defined(__AVX2__)
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i lt = _mm256_cmpgt_epi8(_mm256_set1_epi8(thres), v);
+    return ~(uint32_t)_mm256_movemask_epi8(lt);
+#elif defined(__SSE2__)
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i lt = _mm_cmpgt_epi8(_mm_set1_epi8(thres), v);
+    return ~(uint32_t)_mm_movemask_epi8(lt) & 0xFFFF;
+#else
+    uint32_t mask = 0;
+    for (int l = 0; l < SCAN_W; l++)
+    {
+        mask |= (uint32_t)(p[l] >= thres) << l;
+    }
+    return mask;
+#endif
+}
+
+int scan_threshold_i8(const int8_t *conf, int n, int8_t thres, int32_t *out)
+{
+    int count = 0;
+    int i = 0;
+    for (; i + SCAN_W <= n; i += SCAN_W)
+    {
+        uint32_t mask = ge_mask(conf + i, thres);
+        // 绝大多数块没有候选, 只付出一次比较和一次分支
+        while (mask)
+        {
+            out[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    for (; i < n; i++)
+    {
+        if (conf[i] >= thres)
+        {
+            out[count++] = i;
+        }
+    }
+    return count;
+}
+
+// 块 [blk, blk + SCAN_W) 内所有网格在各平面上的最大值与首个最大平面下标
+static void argmax_block(const int8_t *base, int plane_len, int planes, int blk, int8_t *best, uint8_t *best_id)
+{
+    const int8_t *p = base + blk;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    int8x16_t vbest = vld1q_s8(p);
+    uint8x16_t vid = vdupq_n_u8(0);
+    for (int k = 1; k < planes; k++)
+    {
+        int8x16_t v = vld1q_s8(p + (size_t)k * plane_len);
+        uint8x16_t gt = vcgtq_s8(v, vbest);
+        vbest = vmaxq_s8(v, vbest);
+        vid = vbslq_u8(gt, vdupq_n_u8((uint8_t)k), vid);
+    }
+    vst1q_s8(best, vbest);
+    vst1q_u8(best_id, vid);
+#elif defined(__AVX2__)
+    __m256i vbest = _mm256_loadu_si256((const __m256i *)p);
+    __m256i vid = _mm256_setzero_si256();
+    for (int k = 1; k < planes; k++)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + (size_t)k * plane_len));
+        __m256i gt = _mm256_cmpgt_epi8(v, vbest);
+        vbest = _mm256_max_epi8(v, vbest);
+        vid = _mm256_blendv_epi8(vid, _mm256_set1_epi8((char)k), gt);
+    }
+    _mm256_storeu_si256((__m256i *)best, vbest);
+    _mm256_storeu_si256((__m256i *)best_id, vid);
+#elif defined(__SSE2__)
+    // SSE2 没有有符号字节 max, 用比较结果做选择
+    __m128i vbest = _mm_loadu_si128((const __m128i *)p);
+    __m128i vid = _mm_setzero_si128();
+    for (int k = 1; k < planes; k++)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + (size_t)k * plane_len));
+        __m128i gt = _mm_cmpgt_epi8(v, vbest);
+        vbest = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, vbest));
+        vid = _mm_or_si128(_mm_and_si128(gt, _mm_set1_epi8((char)k)), _mm_andnot_si128(gt, vid));
+    }
+    _mm_storeu_si128((__m128i *)best, vbest);
+    _mm_storeu_si128((__m128i *)best_id, vid);
+#else
+    for (int l = 0; l < SCAN_W; l++)
+    {
+        best[l] = p[l];
+        best_id[l] = 0;
+    }
+    for (int k = 1; k < planes; k++)
+    {
+        const int8_t *q = p + (size_t)k * plane_len;
+        for (int l = 0; l < SCAN_W; l++)
+        {
+            if (q[l] > best[l])
+            {
+                best[l] = q[l];
+                best_id[l] = (uint8_t)k;
+            }
+        }
+    }
+#endif
+}
+
+// 逐平面跨步读取, 用于末尾不足一个向量块的网格
+static void argmax_cell(const int8_t *base, int plane_len, int planes, int cell, int8_t *best, uint8_t *best_id)
+{
+    const int8_t *p = base + cell;
+    int8_t m = p[0];
+    int id = 0;
+    for (int k = 1; k < planes; k++)
+    {
+        int8_t v = p[(size_t)k * plane_len];
+        if (v > m)
+        {
+            m = v;
+            id = k;
+        }
+    }
+    *best = m;
+    *best_id = (uint8_t)id;
+}
+
+void argmax_planes_i8(const int8_t *base, int plane_len, int planes, const int32_t *cells, int count,
+                      int8_t *max_val, uint8_t *max_id)
+{
+    int8_t best[SCAN_W];
+    uint8_t best_id[SCAN_W];
+    int cur_blk = -1;
+    // 最后一个平面之后可能没有可读内存, 越过 full_end 的块只能逐个网格处理
+    int full_end = plane_len - plane_len % SCAN_W;
+    for (int i = 0; i < count; i++)
+    {
+        int cell = cells[i];
+        if (cell >= full_end)
+        {
+            argmax_cell(base, plane_len, planes, cell, max_val + i, max_id + i);
+            continue;
+        }
+        int blk = cell - cell % SCAN_W;
+        if (blk != cur_blk)
+        {
+            // 候选升序, 每个块至多计算一次
+            argmax_block(base, plane_len, planes, blk, best, best_id);
+            cur_blk = blk;
+        }
+        max_val[i] = best[cell - blk];
+        max_id[i] = best_id[cell - blk];
+    }
+}
@@ -15,6 +15,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <iostream>
@@ -22,10 +23,13 @@
 #include <mutex>
 #include <queue>
 #include <vector>
+#include <functional>
 #include <future>
 #include <thread>
+#include <utility>
 
 #include "thread_pool.h"
+#include "trace.h"
 
 template <typename Predictor, typename PredictorParams, typename PredictorInput,
           typename PredictorResult>
@@ -35,6 +39,10 @@ private:
     std::shared_ptr<Predictor> Predictor_;
     std::queue<PredictorInput> task_queue;
     std::queue<std::promise<PredictorResult>> promise_queue;
+    std::queue<std::function<void(PredictorResult &)>> callback_queue;
+    // Batches share the instance's is_busy handoff with single inputs, so
+    // only one pool worker ever drives a given predictor.
+    std::queue<std::function<void(Predictor &)>> batch_queue;
     std::mutex queue_mutex;
     std::atomic<bool> is_busy{false};
     int instance_id;
@@ -45,7 +53,19 @@ public:
   
   bool Init();
 
-  std::future<PredictorResult> PredictAsync(const PredictorInput &input);
+  // on_result, if set, runs on the worker right after Predict and before the
+  // future is ready, so callers can post-process (e.g. fill a cache) without
+  // waiting on get().
+  std::future<PredictorResult>
+  PredictAsync(const PredictorInput &input,
+               std::function<void(PredictorResult &)> on_result = nullptr);
+
+  // Runs Predictor::PredictBatch on one instance, so postprocess is done once
+  // for the whole batch. Results keep the input order. Only instantiated when
+  // called, so predictors without PredictBatch are unaffected.
+  std::future<std::vector<PredictorResult>> PredictBatchAsync(
+      std::vector<PredictorInput> inputs,
+      std::function<void(std::vector<PredictorResult> &)> on_results = nullptr);
 
 
   bool PredictThread(const PredictorInput &input);
@@ -53,9 +73,14 @@ public:
 
   bool GetResult(PredictorResult& result_out);
 
+  // Collects Predictor::GetStats() from every instance, indexed by instance_id.
+  // Only instantiated when called, so predictors without stats are unaffected.
+  auto GetStats();
+
   virtual ~AutoParallelSimpleInferencePredictor();
 
 private:
+  void ScheduleInstance(int instance_id);
   void ProcessInstanceTasks(int instance_id);
   PredictorParams params_;
   int thread_num_;
@@ -74,12 +99,12 @@ template <typename Predictor, typename PredictorParams, typename PredictorInput,
 AutoParallelSimpleInferencePredictor<Predictor, PredictorParams, PredictorInput,
                                     PredictorResult>::
     AutoParallelSimpleInferencePredictor(const PredictorParams &params, int thread_num)
-    : params_(params), thread_num_(thread_num) {
-  if (thread_num_ > 1) {
-    if (!Init()) {
-      std::cerr << "Predictor pool init error." << std::endl;
-      exit(-1);
-    }
+    : params_(params), thread_num_(std::max(thread_num, 1)) {
+  // A single thread still gets one instance and one worker, so every entry
+  // point has a queue to submit to.
+  if (!Init()) {
+    std::cerr << "Predictor pool init error." << std::endl;
+    exit(-1);
   }
 }
 
@@ -111,7 +136,10 @@ template <typename Predictor, typename PredictorParams, typename PredictorInput,
           typename PredictorResult>
 std::future<PredictorResult> AutoParallelSimpleInferencePredictor<
     Predictor, PredictorParams, PredictorInput,
-    PredictorResult>::PredictAsync(const PredictorInput &input) {
+    PredictorResult>::PredictAsync(const PredictorInput &input,
+                                   std::function<void(PredictorResult &)>
+                                       on_result) {
+  PP_TRACE_SCOPE_CAT("PredictAsync", "predictor");
   int instance_id = round_robin_index_.fetch_add(1) % thread_num_;
   auto &instance = instances_[instance_id];
 
@@ -122,12 +150,54 @@ std::future<PredictorResult> AutoParallelSimpleInferencePredictor<
     std::lock_guard<std::mutex> lock(instance->queue_mutex);
     instance->task_queue.push(input);
     instance->promise_queue.push(std::move(promise));
+    instance->callback_queue.push(std::move(on_result));
   }
+  ScheduleInstance(instance_id);
 
+  return future;
+}
+
+template <typename Predictor, typename PredictorParams, typename PredictorInput,
+          typename PredictorResult>
+void AutoParallelSimpleInferencePredictor<
+    Predictor, PredictorParams, PredictorInput,
+    PredictorResult>::ScheduleInstance(int instance_id) {
   bool expected = false;
-  if (instance->is_busy.compare_exchange_strong(expected, true)) {
+  if (instances_[instance_id]->is_busy.compare_exchange_strong(expected, true)) {
     pool_->submit([this, instance_id]() { ProcessInstanceTasks(instance_id); });
   }
+}
+
+template <typename Predictor, typename PredictorParams, typename PredictorInput,
+          typename PredictorResult>
+std::future<std::vector<PredictorResult>> AutoParallelSimpleInferencePredictor<
+    Predictor, PredictorParams, PredictorInput,
+    PredictorResult>::PredictBatchAsync(std::vector<PredictorInput> inputs,
+                                        std::function<void(
+                                            std::vector<PredictorResult> &)>
+                                            on_results) {
+  int instance_id = round_robin_index_.fetch_add(1) % thread_num_;
+  auto &instance = instances_[instance_id];
+  auto batch = std::make_shared<std::vector<PredictorInput>>(std::move(inputs));
+  auto promise = std::make_shared<std::promise<std::vector<PredictorResult>>>();
+  auto future = promise->get_future();
+
+  {
+    std::lock_guard<std::mutex> lock(instance->queue_mutex);
+    instance->batch_queue.push([batch, promise, on_results](
+                                   Predictor &predictor) {
+      try {
+        PP_TRACE_SCOPE_CAT("PredictBatch", "predictor");
+        std::vector<PredictorResult> results = predictor.PredictBatch(*batch);
+        if (on_results)
+          on_results(results);
+        promise->set_value(std::move(results));
+      } catch (...) {
+        promise->set_exception(std::current_exception());
+      }
+    });
+  }
+  ScheduleInstance(instance_id);
 
   return future;
 }
@@ -137,19 +207,22 @@ template <typename Predictor, typename PredictorParams, typename PredictorInput,
 void AutoParallelSimpleInferencePredictor<
     Predictor, PredictorParams, PredictorInput,
     PredictorResult>::ProcessInstanceTasks(int instance_id) {
+  PP_TRACE_SCOPE_CAT("ProcessInstanceTasks", "predictor");
   auto &instance = instances_[instance_id];
 
   while (true) {
     std::promise<PredictorResult> promise;
     
     std::unique_ptr<PredictorInput> input_ptr;
+    std::function<void(PredictorResult &)> on_result;
+    std::function<void(Predictor &)> batch_job;
 
     {
       std::lock_guard<std::mutex> lock(instance->queue_mutex);
-      if (instance->task_queue.empty()) {
+      if (instance->task_queue.empty() && instance->batch_queue.empty()) {
         instance->is_busy = false;
 
-        if (!instance->task_queue.empty()) {
+        if (!instance->task_queue.empty() || !instance->batch_queue.empty()) {
           bool expected = false;
           if (instance->is_busy.compare_exchange_strong(expected, true)) {
             continue;
@@ -158,17 +231,32 @@ void AutoParallelSimpleInferencePredictor<
         return;
       }
       
+      // Batches first: a batch already holds a whole grid row of work.
+      if (!instance->batch_queue.empty()) {
+        batch_job = std::move(instance->batch_queue.front());
+        instance->batch_queue.pop();
+      } else {
+        input_ptr.reset(new PredictorInput(std::move(instance->task_queue.front())));
+        instance->task_queue.pop();
       
-      input_ptr.reset(new PredictorInput(std::move(instance->task_queue.front())));
-      instance->task_queue.pop();
-      
-      promise = std::move(instance->promise_queue.front());
-      instance->promise_queue.pop();
+        promise = std::move(instance->promise_queue.front());
+        instance->promise_queue.pop();
+
+        on_result = std::move(instance->callback_queue.front());
+        instance->callback_queue.pop();
+      }
     } 
 
+    if (batch_job) {
+      batch_job(*instance->Predictor_);
+      continue;
+    }
+
     try {
-    
+      PP_TRACE_SCOPE_CAT("Predict", "predictor");
       PredictorResult result = instance->Predictor_->Predict(*input_ptr);
+      if (on_result)
+        on_result(result);
       promise.set_value(std::move(result));
     } catch (const std::exception &e) {
       promise.set_exception(std::current_exception());
@@ -216,6 +304,19 @@ bool AutoParallelSimpleInferencePredictor<Predictor, PredictorParams, PredictorI
   }
 }
 
+template <typename Predictor, typename PredictorParams, typename PredictorInput,
+          typename PredictorResult>
+auto AutoParallelSimpleInferencePredictor<Predictor, PredictorParams, PredictorInput,
+                                    PredictorResult>::GetStats() {
+  using Stats = decltype(std::declval<Predictor &>().GetStats());
+  std::vector<Stats> stats;
+  stats.reserve(instances_.size());
+  for (auto &instance : instances_) {
+    stats.push_back(instance->Predictor_->GetStats());
+  }
+  return stats;
+}
+
 template <typename Predictor, typename PredictorParams, typename PredictorInput,
           typename PredictorResult>
 AutoParallelSimpleInferencePredictor<
@@ -43,6 +43,7 @@ size_t ThreadPool::threadsNum() const {
 }
 
 void ThreadPool::worker() {
+  PP_TRACE_THREAD_NAME("pool worker");
   while (true) {
     Task task;
     {
@@ -67,6 +68,7 @@ void ThreadPool::worker() {
       task = std::move(tasks_.front());
       tasks_.pop();
     }
+    PP_TRACE_SCOPE_CAT("ThreadPool::task", "pool");
     task();
   }
 }
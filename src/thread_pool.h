@@ -24,6 +24,8 @@
 #include <thread>
 #include <unordered_map>
 
+#include "trace.h"
+
 namespace PaddlePool {
 
 class ThreadPool {
@@ -72,6 +74,7 @@ namespace PaddlePool {
 template <typename Func, typename... Ts>
 auto ThreadPool::submit(Func &&func, Ts &&...params)
     -> std::future<typename std::result_of<Func(Ts...)>::type> {
+  PP_TRACE_SCOPE_CAT("ThreadPool::submit", "pool");
   auto execute =
       std::bind(std::forward<Func>(func), std::forward<Ts>(params)...);
 
@@ -81,10 +84,16 @@ auto ThreadPool::submit(Func &&func, Ts &&...params)
   auto task = std::make_shared<PackagedTask>(std::move(execute));
   auto result = task->get_future();
 
+  // Runs inside the worker's task slice, so the arrow lands on it.
+  uint64_t flow = PP_TRACE_FLOW_BEGIN("task", "pool");
+
   MutexGuard guard(mutex_);
   assert(!quit_);
 
-  tasks_.emplace([task]() { (*task)(); });
+  tasks_.emplace([task, flow]() {
+    PP_TRACE_FLOW_END("task", "pool", flow);
+    (*task)();
+  });
   if (idleThreads_ > 0) {
     cv_.notify_one();
   } else if (currentThreads_ < maxThreads_) {
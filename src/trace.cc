@@ -0,0 +1,233 @@
+// Copyright (c) 2025 PaddlePaddle Authors. All Rights Reserved.
+// Copyright (c) 2025 guoshengjian Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace PaddlePool {
+namespace trace {
+
+std::atomic<bool> g_enabled{false};
+
+namespace {
+
+struct Event {
+  const char *name;
+  const char *cat;
+  uint64_t ts;
+  uint64_t arg; // duration for "X", flow id for "s" / "f"
+  char ph;
+};
+
+constexpr size_t kBlockEvents = 4096;
+
+// Single writer (the owning thread), any number of readers under the
+// registry lock. Blocks are allocated on demand and never moved, and the
+// event count is published with release so readers see complete events.
+struct ThreadBuffer {
+  explicit ThreadBuffer(int tid, size_t capacity)
+      : tid(tid), max_blocks((capacity + kBlockEvents - 1) / kBlockEvents),
+        blocks(new std::atomic<Event *>[max_blocks]) {
+    for (size_t i = 0; i < max_blocks; ++i)
+      blocks[i].store(nullptr, std::memory_order_relaxed);
+  }
+  ~ThreadBuffer() {
+    for (size_t i = 0; i < max_blocks; ++i)
+      delete[] blocks[i].load(std::memory_order_relaxed);
+  }
+
+  void push(const Event &event) {
+    size_t n = count.load(std::memory_order_relaxed);
+    size_t block = n / kBlockEvents;
+    if (block >= max_blocks) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    Event *events = blocks[block].load(std::memory_order_relaxed);
+    if (!events) {
+      events = new Event[kBlockEvents];
+      blocks[block].store(events, std::memory_order_release);
+    }
+    events[n % kBlockEvents] = event;
+    count.store(n + 1, std::memory_order_release);
+  }
+
+  const int tid;
+  const size_t max_blocks;
+  std::unique_ptr<std::atomic<Event *>[]> blocks;
+  std::atomic<size_t> count{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<bool> alive{true};
+  size_t start = 0;  // first event not yet cleared, reader side only
+  std::string name;  // guarded by Registry::mutex
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  int next_tid = 1;
+  size_t capacity = 1 << 20;
+};
+
+Registry &registry() {
+  static Registry *instance = new Registry(); // outlives exiting threads
+  return *instance;
+}
+
+struct ThreadSlot {
+  std::shared_ptr<ThreadBuffer> buffer;
+  const char *pending_name = nullptr;
+  ~ThreadSlot() {
+    if (buffer)
+      buffer->alive.store(false, std::memory_order_release);
+  }
+};
+
+thread_local ThreadSlot t_slot;
+
+ThreadBuffer &thread_buffer() {
+  if (!t_slot.buffer) {
+    Registry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto buffer = std::make_shared<ThreadBuffer>(reg.next_tid++, reg.capacity);
+    buffer->name = t_slot.pending_name
+                       ? t_slot.pending_name
+                       : "thread " + std::to_string(buffer->tid);
+    reg.buffers.push_back(buffer);
+    t_slot.buffer = std::move(buffer);
+  }
+  return *t_slot.buffer;
+}
+
+void write_escaped(FILE *fp, const char *s) {
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', fp);
+    if ((unsigned char)*s >= 0x20)
+      fputc(*s, fp);
+  }
+}
+
+std::atomic<uint64_t> g_next_flow{1};
+
+} // namespace
+
+void set_enabled(bool on) {
+  now_ns(); // pin the time origin before the first event
+  g_enabled.store(on, std::memory_order_relaxed);
+}
+
+uint64_t now_ns() {
+  static const auto origin = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - origin)
+      .count();
+}
+
+void set_thread_name(const char *name) {
+  t_slot.pending_name = name;
+  if (t_slot.buffer) {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    t_slot.buffer->name = name;
+  }
+}
+
+void complete(const char *name, const char *cat, uint64_t begin_ns,
+              uint64_t end_ns) {
+  thread_buffer().push(Event{name, cat, begin_ns, end_ns - begin_ns, 'X'});
+}
+
+uint64_t flow_begin(const char *name, const char *cat) {
+  uint64_t id = g_next_flow.fetch_add(1, std::memory_order_relaxed);
+  thread_buffer().push(Event{name, cat, now_ns(), id, 's'});
+  return id;
+}
+
+void flow_end(const char *name, const char *cat, uint64_t id) {
+  thread_buffer().push(Event{name, cat, now_ns(), id, 'f'});
+}
+
+void set_thread_capacity(size_t events) {
+  std::lock_guard<std::mutex> lock(registry().mutex);
+  registry().capacity = events;
+}
+
+uint64_t dropped() {
+  Registry &reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  uint64_t total = 0;
+  for (auto &buffer : reg.buffers)
+    total += buffer->dropped.load(std::memory_order_relaxed);
+  return total;
+}
+
+bool dump(const std::string &path) {
+  FILE *fp = fopen(path.c_str(), "w");
+  if (!fp)
+    return false;
+
+  Registry &reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first = true;
+  for (auto &buffer : reg.buffers) {
+    fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":\"",
+            first ? "" : ",\n", buffer->tid);
+    write_escaped(fp, buffer->name.c_str());
+    fprintf(fp, "\"}}");
+    first = false;
+
+    size_t count = buffer->count.load(std::memory_order_acquire);
+    for (size_t i = buffer->start; i < count; ++i) {
+      const Event &e = buffer->blocks[i / kBlockEvents].load(
+          std::memory_order_acquire)[i % kBlockEvents];
+      fprintf(fp, ",\n{\"name\":\"");
+      write_escaped(fp, e.name);
+      fprintf(fp, "\",\"cat\":\"");
+      write_escaped(fp, e.cat);
+      fprintf(fp, "\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", e.ph,
+              e.ts / 1000.0, buffer->tid);
+      if (e.ph == 'X')
+        fprintf(fp, ",\"dur\":%.3f}", e.arg / 1000.0);
+      else if (e.ph == 'f') // bind to the enclosing slice, e.g. the task run
+        fprintf(fp, ",\"id\":%llu,\"bp\":\"e\"}", (unsigned long long)e.arg);
+      else
+        fprintf(fp, ",\"id\":%llu}", (unsigned long long)e.arg);
+    }
+  }
+  fprintf(fp, "\n]}\n");
+  return fclose(fp) == 0;
+}
+
+void clear() {
+  Registry &reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  std::vector<std::shared_ptr<ThreadBuffer>> live;
+  for (auto &buffer : reg.buffers) {
+    if (!buffer->alive.load(std::memory_order_acquire))
+      continue; // exited thread, drop its events and memory
+    buffer->start = buffer->count.load(std::memory_order_acquire);
+    live.push_back(buffer);
+  }
+  reg.buffers.swap(live);
+}
+
+} // namespace trace
+} // namespace PaddlePool
@@ -0,0 +1,115 @@
+// Copyright (c) 2025 PaddlePaddle Authors. All Rights Reserved.
+// Copyright (c) 2025 guoshengjian Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Timeline tracing in Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+//
+// Events go to per-thread buffers without locking; only a thread's first
+// event takes the registry lock. Names and categories must be string
+// literals (or otherwise outlive the dump), since only the pointer is kept.
+//
+// Build with PADDLEPOOL_TRACE=0 to compile every PP_TRACE_* macro away. With
+// tracing compiled in but not enabled at runtime, a scope costs one relaxed
+// load and a branch.
+#ifndef PADDLEPOOL_TRACE
+#define PADDLEPOOL_TRACE 1
+#endif
+
+namespace PaddlePool {
+namespace trace {
+
+extern std::atomic<bool> g_enabled;
+
+inline bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+void set_enabled(bool on);
+
+// Nanoseconds on the monotonic clock since the first call in the process.
+uint64_t now_ns();
+
+// Names the calling thread in the dumped timeline.
+void set_thread_name(const char *name);
+
+// Complete event ("X") for [begin_ns, end_ns) on the calling thread.
+void complete(const char *name, const char *cat, uint64_t begin_ns,
+              uint64_t end_ns);
+// Flow arrows ("s" -> "f") link e.g. a submit to the task run it caused.
+uint64_t flow_begin(const char *name, const char *cat);
+void flow_end(const char *name, const char *cat, uint64_t id);
+
+// Per-thread event cap; later events are dropped and counted.
+void set_thread_capacity(size_t events);
+uint64_t dropped();
+
+// Writes every buffered event; safe while other threads keep tracing, events
+// recorded during the dump may or may not be included.
+bool dump(const std::string &path);
+void clear();
+
+class Scope {
+public:
+  Scope(const char *name, const char *cat = "app") : name_(nullptr) {
+    if (enabled()) {
+      name_ = name;
+      cat_ = cat;
+      begin_ = now_ns();
+    }
+  }
+  ~Scope() {
+    if (name_)
+      complete(name_, cat_, begin_, now_ns());
+  }
+
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+
+private:
+  const char *name_;
+  const char *cat_;
+  uint64_t begin_;
+};
+
+} // namespace trace
+} // namespace PaddlePool
+
+#define PP_TRACE_CONCAT_(a, b) a##b
+#define PP_TRACE_CONCAT(a, b) PP_TRACE_CONCAT_(a, b)
+
+#if PADDLEPOOL_TRACE
+#define PP_TRACE_SCOPE(name)                                                   \
+  ::PaddlePool::trace::Scope PP_TRACE_CONCAT(pp_trace_scope_, __LINE__)(name)
+#define PP_TRACE_SCOPE_CAT(name, cat)                                          \
+  ::PaddlePool::trace::Scope PP_TRACE_CONCAT(pp_trace_scope_, __LINE__)(name,  \
+                                                                       cat)
+#define PP_TRACE_THREAD_NAME(name) ::PaddlePool::trace::set_thread_name(name)
+#define PP_TRACE_FLOW_BEGIN(name, cat)                                         \
+  (::PaddlePool::trace::enabled()                                              \
+       ? ::PaddlePool::trace::flow_begin(name, cat)                            \
+       : uint64_t(0))
+#define PP_TRACE_FLOW_END(name, cat, id)                                       \
+  do {                                                                         \
+    if (id)                                                                    \
+      ::PaddlePool::trace::flow_end(name, cat, id);                            \
+  } while (0)
+#else
+#define PP_TRACE_SCOPE(name) ((void)0)
+#define PP_TRACE_SCOPE_CAT(name, cat) ((void)0)
+#define PP_TRACE_THREAD_NAME(name) ((void)0)
+#define PP_TRACE_FLOW_BEGIN(name, cat) uint64_t(0)
+#define PP_TRACE_FLOW_END(name, cat, id) ((void)(id))
+#endif